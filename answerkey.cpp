@@ -0,0 +1,394 @@
+#include <QtCore>
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+#include <climits>
+
+#include <numformat.h>
+#include <answerkey.h>
+
+/*************************
+** Parsing Helpers
+*************************/
+
+template<class C>
+static inline bool isSpace(C c)
+{
+    return c == C(' ') || c == C('\t') || c == C('\r') || c == C('\n')
+        || c == C('\v') || c == C('\f');
+}
+
+//*******************************************************************
+template<class C>
+static void trim(const C*& first, const C*& last)
+{
+    while(first < last && isSpace(*first))
+        ++first;
+    while(last > first && isSpace(last[-1]))
+        --last;
+}
+
+//*******************************************************************
+// Returns mant * 10^exp10 as a double.
+//
+static double scale(qint64 mant, int exp10)
+{
+    static const double pow10[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10,
+        1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21,
+        1e22
+    };
+
+    if(exp10 >= 0 && exp10 <= 22)
+        return (double)mant * pow10[exp10];
+    if(exp10 < 0 && exp10 >= -22)
+        return (double)mant / pow10[-exp10];
+    return (double)mant * std::pow(10.0, exp10);
+}
+
+//*******************************************************************
+// parseInt, parseFloat, parseFraction
+//
+// Each reads the whole of [first, last), less white space at either
+// end, and returns false if any of it isn't part of the number.
+//
+template<class C>
+static bool parseInt(const C* first, const C* last, qint64& value)
+{
+    trim(first, last);
+    const C* p = nf::fromChars(first, last, value);
+    return p != 0 && p == last;
+}
+
+template<class C>
+static bool parseFloat(const C* first, const C* last, double& value)
+{
+    qint64 mant;
+    int exp10;
+
+    trim(first, last);
+    const C* p = nf::fromChars(first, last, mant, exp10);
+    if(p == 0 || p != last)
+        return false;
+
+    value = scale(mant, exp10);
+    return true;
+}
+
+// A fraction is "n/d", an integer, or a decimal, which is taken exactly.
+//
+template<class C>
+static bool parseFraction(const C* first, const C* last, Fraction& value)
+{
+    qint64 num;
+    qint64 den = 1;
+    int exp10;
+
+    trim(first, last);
+    const C* p = nf::fromChars(first, last, num, exp10);
+    if(p == 0)
+        return false;
+
+    if(p < last && *p == C('/')) {
+        if(exp10 != 0)
+            return false;
+        p = nf::fromChars(p + 1, last, den);
+        if(p == 0 || den == 0)
+            return false;
+    } else {
+        for(; exp10 > 0; --exp10) {
+            if(num > LLONG_MAX / 10 || num < LLONG_MIN / 10)
+                return false;
+            num *= 10;
+        }
+        for(; exp10 < 0; ++exp10) {
+            if(den > LLONG_MAX / 10)
+                return false;
+            den *= 10;
+        }
+    }
+
+    if(p != last)
+        return false;
+
+    value = Fraction(num, den);
+    return value.isValid();
+}
+
+//*******************************************************************
+// nextPoint
+//
+// Read one code point, from UTF-8 or UTF-16. A bad sequence reads as
+// U+FFFD.
+//
+static uint nextPoint(const char*& p, const char* end)
+{
+    uint c = (uchar)*p++;
+    int more;
+
+    if(c < 0x80)
+        return c;
+    else if((c & 0xe0) == 0xc0) {
+        more = 1;
+        c &= 0x1f;
+    } else if((c & 0xf0) == 0xe0) {
+        more = 2;
+        c &= 0x0f;
+    } else if((c & 0xf8) == 0xf0) {
+        more = 3;
+        c &= 0x07;
+    } else
+        return 0xfffd;
+
+    for(; more > 0; --more) {
+        if(p >= end || ((uchar)*p & 0xc0) != 0x80)
+            return 0xfffd;
+        c = (c << 6) | ((uchar)*p++ & 0x3f);
+    }
+    return c;
+}
+
+static uint nextPoint(const ushort*& p, const ushort* end)
+{
+    uint c = *p++;
+
+    if(c >= 0xd800 && c < 0xdc00 && p < end && *p >= 0xdc00 && *p < 0xe000)
+        return 0x10000 + ((c - 0xd800) << 10) + (*p++ - 0xdc00);
+    return c;
+}
+
+// Reads text the way a KeyText compares it: trimmed, with each run of
+// white space read as one space and ASCII letters in lower case.
+// next() returns -1 at the end.
+//
+template<class C>
+struct TextReader
+{
+    const C* p;
+    const C* end;
+
+    TextReader(const C* first, const C* last)
+    {
+        trim(first, last);
+        p = first;
+        end = last;
+    }
+
+    int next()
+    {
+        if(p >= end)
+            return -1;
+
+        if(isSpace(*p)) {
+            while(p < end && isSpace(*p))
+                ++p;
+            return ' ';
+        }
+
+        uint c = nextPoint(p, end);
+        return (c >= 'A' && c <= 'Z') ? int(c + 32) : int(c);
+    }
+};
+
+/***********************
+** AnswerKey Routines
+***********************/
+
+//*******************************************************************
+void AnswerKey::setInt(qint64 value)
+{
+    m_kind = KeyInt;
+    m_int = value;
+}
+
+//*******************************************************************
+// setFloat
+//
+// tolerance - the most an answer may be off by and still be correct
+//
+void AnswerKey::setFloat(double value, double tolerance)
+{
+    m_kind = KeyFloat;
+    m_float = value;
+    m_tolerance = qAbs(tolerance);
+}
+
+//*******************************************************************
+void AnswerKey::setFraction(const Fraction& value)
+{
+    m_kind = KeyFraction;
+    m_fraction = value;
+}
+
+//*******************************************************************
+// setText
+//
+// The text is normalized once here, so check() need only normalize the
+// answer.
+//
+void AnswerKey::setText(const QString& text)
+{
+    const ushort* u = (const ushort*)text.utf16();
+    TextReader<ushort> in(u, u + text.size());
+
+    m_kind = KeyText;
+    m_text.resize(0);
+
+    // Only white space and ASCII letters change, so the text can be
+    // copied a code unit at a time.
+    //
+    while(in.p < in.end) {
+        if(isSpace(*in.p)) {
+            in.next();
+            m_text.append(QChar(' '));
+        } else {
+            ushort c = *in.p++;
+            m_text.append(QChar((c >= 'A' && c <= 'Z') ? c + 32 : c));
+        }
+    }
+}
+
+//*******************************************************************
+// setAnswer
+//
+// Set the key from a correct answer in text, such as
+// TestParm::correctAnswer.
+//
+// type      - ans_int, ans_float or ans_string. An ans_float answer
+//             written as "n/d" makes a KeyFraction key.
+// text      - the correct answer
+// tolerance - for a KeyFloat key, as for setFloat()
+//
+// Returns false, leaving the key as it was, if the text isn't a number
+// of the type.
+//
+bool AnswerKey::setAnswer(tp::answer_t type, const QString& text,
+                          double tolerance)
+{
+    const ushort* first = (const ushort*)text.utf16();
+    const ushort* last = first + text.size();
+
+    switch(type) {
+    case tp::ans_int: {
+        qint64 value;
+        if(!parseInt(first, last, value))
+            return false;
+        setInt(value);
+        return true;
+    }
+
+    case tp::ans_float: {
+        double value;
+        Fraction frac;
+
+        if(parseFloat(first, last, value))
+            setFloat(value, tolerance);
+        else if(parseFraction(first, last, frac))
+            setFraction(frac);
+        else
+            return false;
+        return true;
+    }
+
+    default:
+        setText(text);
+        return true;
+    }
+}
+
+//*******************************************************************
+// check
+//
+// Returns true if the answer in [first, last), UTF-8, matches the key.
+//
+bool AnswerKey::check(const char* first, const char* last) const
+{
+    return match(first, last);
+}
+
+//*******************************************************************
+bool AnswerKey::check(const QString& answer) const
+{
+    const ushort* u = (const ushort*)answer.utf16();
+    return match(u, u + answer.size());
+}
+
+//*******************************************************************
+// checkSheet
+//
+// Grade a sheet of answers, one per line, in order. Line i is checked
+// against keys[i], and a sheet with too few lines is wrong in the
+// problems left over.
+//
+// keys    - the answer keys
+// count   - the number of keys
+// sheet   - the answers, UTF-8. Lines may end in "\n" or "\r\n".
+// size    - the size of the sheet
+// results - if not 0, receives count results, true for each correct
+//           answer
+//
+// Returns the number of correct answers.
+//
+int AnswerKey::checkSheet(const AnswerKey* keys, int count,
+                          const char* sheet, int size, bool* results)
+{
+    const char* p = sheet;
+    const char* end = sheet + size;
+    int correct = 0;
+
+    for(int i = 0; i < count; ++i) {
+        const char* eol = (p < end) ? (const char*)memchr(p, '\n', end - p) : 0;
+        const char* stop = eol ? eol : end;
+        bool ok = keys[i].match(p, stop);
+
+        if(results)
+            results[i] = ok;
+        correct += ok;
+        p = eol ? eol + 1 : end;
+    }
+    return correct;
+}
+
+//*******************************************************************
+// match
+//
+// The body of check(), for char (UTF-8) and ushort (UTF-16) text.
+//
+template<class C>
+bool AnswerKey::match(const C* first, const C* last) const
+{
+    switch(m_kind) {
+    case KeyInt: {
+        qint64 value;
+        return parseInt(first, last, value) && value == m_int;
+    }
+
+    case KeyFloat: {
+        double value;
+        if(!parseFloat(first, last, value))
+            return false;
+
+        double slack = 4 * DBL_EPSILON * qMax(qAbs(value), qAbs(m_float));
+        return qAbs(value - m_float) <= m_tolerance + slack;
+    }
+
+    case KeyFraction: {
+        Fraction value;
+        return parseFraction(first, last, value) && value == m_fraction;
+    }
+
+    default: {
+        const ushort* k = (const ushort*)m_text.utf16();
+        TextReader<C> in(first, last);
+        TextReader<ushort> key(k, k + m_text.size());
+
+        for(;;) {
+            int a = in.next();
+            if(a != key.next())
+                return false;
+            if(a < 0)
+                return true;
+        }
+    }
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef ANSWERKEY_H
+#define ANSWERKEY_H
+
+#include <QString>
+#include <fraction.h>
+#include <testparm.h>
+
+//********************************************************************
+//
+// class AnswerKey
+//
+// The correct answer to a problem, kept as a value of its own type
+// rather than as text, and checked against what the user typed without
+// building any strings.
+//
+// KeyInt      - "07", "+7" and " 7 " all match 7
+// KeyFloat    - any decimal within the tolerance matches, so "0.50" and
+//               ".5" both match 0.5. A tolerance of 0 still allows for
+//               rounding in the last few bits.
+// KeyFraction - "n/d", an integer, or an exact decimal, which is matched
+//               in lowest terms, so "2/4", "1/2" and "0.5" all match 1/2
+// KeyText     - matched after trimming, folding runs of white space to
+//               one space and ignoring case in ASCII letters
+//
+// check() reads the answer straight from a char buffer, taken as UTF-8,
+// or from a QString. checkSheet() grades a whole answer sheet, one
+// answer per line, against an array of keys.
+//
+class AnswerKey
+{
+public:
+    enum Kind {KeyInt, KeyFloat, KeyFraction, KeyText};
+
+    AnswerKey() {setInt(0);}
+
+    void setInt(qint64 value);
+    void setFloat(double value, double tolerance = 0);
+    void setFraction(const Fraction& value);
+    void setText(const QString& text);
+    bool setAnswer(tp::answer_t type, const QString& text,
+                   double tolerance = 0);
+
+    Kind kind() const {return m_kind;}
+
+    bool check(const char* first, const char* last) const;
+    bool check(const QString& answer) const;
+
+    static int checkSheet(const AnswerKey* keys, int count,
+                          const char* sheet, int size,
+                          bool* results = 0);
+
+private:
+    Kind m_kind;
+    qint64 m_int;
+    double m_float;
+    double m_tolerance;
+    Fraction m_fraction;
+    QString m_text;             // Normalized
+
+    template<class C> bool match(const C* first, const C* last) const;
+};
+
+#endif // ANSWERKEY_H
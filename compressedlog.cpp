@@ -0,0 +1,389 @@
+#include <QtCore>
+#include <zlib.h>
+
+#if defined(Q_OS_WIN)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <compressedlog.h>
+
+#define FRAME_MAGIC     0x465a504d  // "MPZF", a chunk that starts a frame
+#define CHUNK_MAGIC     0x435a504d  // "MPZC", a chunk that continues one
+
+// Header in front of each compressed chunk. rawOffset lets a reader
+// place a chunk in the log without reading the chunks before it.
+//
+struct ChunkHeader
+{
+    quint32 magic;
+    quint32 rawSize;            // Bytes before compression
+    quint32 compSize;           // Bytes of compressed data that follow
+    quint32 check;              // qChecksum of the compressed data
+    qint64 rawOffset;           // Uncompressed offset of the chunk
+};
+
+static_assert(sizeof(ChunkHeader) == 24, "ChunkHeader layout changed");
+
+/***************************
+** CompressedSink Routines
+***************************/
+
+//*******************************************************************
+// CompressedSink constructor
+//
+// baseName   - path and name of the log files, without the number
+// maxBytes   - start a new file once the current one is this big
+// frameBytes - uncompressed bytes in a frame before the stream is reset
+// level      - zlib compression level, 0 to 9
+//
+// The stream is raw deflate, without zlib's header and trailer, since
+// the chunk headers already carry the sizes and a checksum.
+//
+CompressedSink::CompressedSink(const QString& baseName, qint64 maxBytes,
+                               int frameBytes, int level)
+{
+    m_baseName = baseName;
+    m_maxBytes = maxBytes > 0 ? maxBytes : 1;
+    m_frameBytes = frameBytes > 0 ? frameBytes : 1;
+    m_level = qBound(0, level, 9);
+    m_fileIndex = 0;
+    m_rawOffset = 0;
+    m_frameRaw = 0;
+    m_rawTotal = 0;
+    m_compTotal = 0;
+    m_failed = false;
+
+    m_stream = new z_stream;
+    memset(m_stream, 0, sizeof(z_stream));
+    if(deflateInit2(m_stream, m_level, Z_DEFLATED, -MAX_WBITS, 8,
+                    Z_DEFAULT_STRATEGY) != Z_OK) {
+        delete m_stream;
+        m_stream = 0;
+        m_failed = true;
+    }
+}
+
+//*******************************************************************
+CompressedSink::~CompressedSink()
+{
+    writeChunk();
+    m_file.close();
+
+    if(m_stream) {
+        deflateEnd(m_stream);
+        delete m_stream;
+    }
+}
+
+//*******************************************************************
+// write
+//
+// Data is only gathered here. It is compressed when it is flushed, or
+// when it would fill the current frame.
+//
+bool CompressedSink::write(const char* data, int size)
+{
+    m_pending.append(data, size);
+
+    if(m_frameRaw + m_pending.size() >= m_frameBytes)
+        return writeChunk();
+    return true;
+}
+
+//*******************************************************************
+// flush
+//
+// Write what has been gathered as a chunk and flush the file. The frame
+// and the stream carry on.
+//
+bool CompressedSink::flush()
+{
+    if(!writeChunk())
+        return false;
+
+    return !m_file.isOpen() || m_file.flush();
+}
+
+//*******************************************************************
+bool CompressedSink::sync()
+{
+    if(!flush())
+        return false;
+    if(!m_file.isOpen())
+        return true;
+
+#if defined(Q_OS_WIN)
+    return _commit(m_file.handle()) == 0;
+#else
+    return ::fsync(m_file.handle()) == 0;
+#endif
+}
+
+//*******************************************************************
+// rotate
+//
+// Close off the current file. The next write starts a new one.
+//
+bool CompressedSink::rotate()
+{
+    bool ok = writeChunk();
+    m_file.close();
+    return ok;
+}
+
+//*******************************************************************
+// writeChunk
+//
+// Compress the pending data up to a sync flush and write it as a chunk,
+// opening a file first if there isn't one open. The first chunk of a
+// frame resets the stream. A frame ends once it holds frameBytes, and a
+// file is closed once it has reached maxBytes.
+//
+// If the chunk can't be written the file is closed, as it may end in
+// part of one, and the pending data is kept. The next chunk tries it
+// again in a new file, which starts with a new frame.
+//
+bool CompressedSink::writeChunk()
+{
+    if(m_pending.isEmpty())
+        return true;
+
+    if(m_stream == 0 || (!m_file.isOpen() && !openNext()))
+        return false;
+
+    bool startsFrame = m_frameRaw == 0;
+    if(startsFrame)
+        deflateReset(m_stream);
+
+    // Deflate with a sync flush leaves nothing behind in the stream, so
+    // the chunk can be inflated as soon as it's read. Grow the output
+    // until zlib stops filling it.
+    //
+    int rawSize = m_pending.size();
+    int have = 0;
+
+    m_stream->next_in = (Bytef*)m_pending.data();
+    m_stream->avail_in = (uInt)rawSize;
+
+    do {
+        m_comp.resize(have + (int)deflateBound(m_stream, rawSize) + 16);
+        m_stream->next_out = (Bytef*)m_comp.data() + have;
+        m_stream->avail_out = (uInt)(m_comp.size() - have);
+
+        if(deflate(m_stream, Z_SYNC_FLUSH) == Z_STREAM_ERROR) {
+            m_failed = true;
+            return false;
+        }
+        have = m_comp.size() - (int)m_stream->avail_out;
+    } while(m_stream->avail_out == 0);
+
+    ChunkHeader hdr;
+
+    hdr.magic = startsFrame ? FRAME_MAGIC : CHUNK_MAGIC;
+    hdr.rawSize = (quint32)rawSize;
+    hdr.compSize = (quint32)have;
+    hdr.check = qChecksum(m_comp.constData(), have);
+    hdr.rawOffset = m_rawOffset;
+
+    bool ok = m_file.write((const char*)&hdr, sizeof(hdr)) == sizeof(hdr)
+           && m_file.write(m_comp.constData(), have) == have;
+
+    m_failed = !ok;
+    if(!ok) {
+        m_file.close();
+        return false;
+    }
+
+    m_rawOffset += rawSize;
+    m_frameRaw += rawSize;
+    m_rawTotal += rawSize;
+    m_compTotal += sizeof(hdr) + have;
+    m_pending.resize(0);
+
+    if(m_frameRaw >= m_frameBytes)
+        m_frameRaw = 0;
+
+    if(m_file.size() >= m_maxBytes)
+        m_file.close();
+
+    return true;
+}
+
+//*******************************************************************
+// openNext
+//
+// Open the first numbered file that doesn't exist yet. The file is
+// created with NewOnly, so if another process takes a name first the
+// open fails and the next number is tried. Each file starts with a new
+// frame.
+//
+bool CompressedSink::openNext()
+{
+    m_rawOffset = 0;
+    m_frameRaw = 0;
+
+    for(;; ++m_fileIndex) {
+        m_file.setFileName(fileName(m_fileIndex));
+        if(m_file.open(QIODevice::WriteOnly | QIODevice::NewOnly))
+            break;
+        if(!m_file.exists()) {
+            m_failed = true;
+            return false;
+        }
+    }
+    return true;
+}
+
+//*******************************************************************
+QString CompressedSink::fileName(int index) const
+{
+    return QString("%1.%2.mpz").arg(m_baseName).arg(index, 4, 10, QChar('0'));
+}
+
+/********************************
+** CompressedLogReader Routines
+********************************/
+
+//*******************************************************************
+// open
+//
+// Read the chunk headers of a file. A damaged or partial chunk ends the
+// file, and the chunks before it can still be read.
+//
+// Returns false if the file can't be opened.
+//
+bool CompressedLogReader::open(const QString& fileName)
+{
+    close();
+
+    m_file.setFileName(fileName);
+    if(!m_file.open(QIODevice::ReadOnly))
+        return false;
+
+    qint64 size = m_file.size();
+    qint64 pos = 0;
+    ChunkHeader hdr;
+
+    while(size - pos >= (qint64)sizeof(hdr)) {
+        if(!m_file.seek(pos)
+        || m_file.read((char*)&hdr, sizeof(hdr)) != sizeof(hdr))
+            break;
+
+        if((hdr.magic != FRAME_MAGIC && hdr.magic != CHUNK_MAGIC)
+        || (pos == 0 && hdr.magic != FRAME_MAGIC)
+        || hdr.rawOffset != m_rawSize
+        || size - pos - (qint64)sizeof(hdr) < hdr.compSize)
+            break;
+
+        Chunk c;
+        c.fileOffset = pos + sizeof(hdr);
+        c.rawOffset = hdr.rawOffset;
+        c.rawSize = hdr.rawSize;
+        c.compSize = hdr.compSize;
+        c.check = hdr.check;
+        c.startsFrame = hdr.magic == FRAME_MAGIC;
+        m_chunks << c;
+
+        m_rawSize += hdr.rawSize;
+        pos = c.fileOffset + hdr.compSize;
+    }
+    return true;
+}
+
+//*******************************************************************
+void CompressedLogReader::close()
+{
+    m_file.close();
+    m_chunks.clear();
+    m_rawSize = 0;
+}
+
+//*******************************************************************
+// read
+//
+// Returns the uncompressed bytes from offset on, up to length of them.
+// Inflating starts at the frame holding offset, as the chunks before it
+// in the frame are needed to inflate it. Reading stops short at a chunk
+// that fails its checksum or doesn't inflate to its size.
+//
+QByteArray CompressedLogReader::read(qint64 offset, qint64 length)
+{
+    QByteArray out;
+
+    if(offset < 0 || offset >= m_rawSize || length <= 0)
+        return out;
+
+    qint64 end = qMin(m_rawSize, offset + length);
+    out.reserve((int)(end - offset));
+
+    int i = findChunk(offset);
+    while(i > 0 && !m_chunks[i].startsFrame)
+        --i;
+
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if(inflateInit2(&zs, -MAX_WBITS) != Z_OK)
+        return out;
+
+    QByteArray raw;
+
+    for(; i < m_chunks.size(); ++i) {
+        const Chunk& c = m_chunks[i];
+        if(c.rawOffset >= end)
+            break;
+
+        if(!m_file.seek(c.fileOffset))
+            break;
+        QByteArray comp = m_file.read(c.compSize);
+        if(comp.size() != (int)c.compSize
+        || c.check != qChecksum(comp.constData(), comp.size()))
+            break;
+
+        if(c.startsFrame)
+            inflateReset(&zs);
+
+        // One byte spare, so a chunk that inflates to more than its size
+        // is caught rather than cut short.
+        //
+        raw.resize((int)c.rawSize + 1);
+        zs.next_in = (Bytef*)comp.data();
+        zs.avail_in = (uInt)comp.size();
+        zs.next_out = (Bytef*)raw.data();
+        zs.avail_out = (uInt)raw.size();
+
+        int rc = inflate(&zs, Z_SYNC_FLUSH);
+        if((rc != Z_OK && rc != Z_BUF_ERROR) || zs.avail_in != 0
+        || zs.avail_out != 1)
+            break;
+
+        qint64 from = qMax(offset, c.rawOffset) - c.rawOffset;
+        qint64 to = qMin(end, c.rawOffset + c.rawSize) - c.rawOffset;
+        if(from < to)
+            out.append(raw.constData() + from, (int)(to - from));
+    }
+
+    inflateEnd(&zs);
+    return out;
+}
+
+//*******************************************************************
+// findChunk
+//
+// Returns the chunk holding an uncompressed offset, by binary search.
+//
+int CompressedLogReader::findChunk(qint64 rawOffset) const
+{
+    int lo = 0;
+    int hi = m_chunks.size() - 1;
+
+    while(lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if(m_chunks[mid].rawOffset <= rawOffset)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    return lo;
+}
@@ -0,0 +1,114 @@
+#ifndef COMPRESSEDLOG_H
+#define COMPRESSEDLOG_H
+
+#include <QFile>
+#include <QVector>
+#include <QString>
+#include <QByteArray>
+#include <resultsink.h>
+
+struct z_stream_s;
+
+//********************************************************************
+//
+// class CompressedSink
+//
+// A ResultSink that writes the log through one zlib deflate stream per
+// file, using Qt's bundled zlib. flush() and sync() end the data written
+// so far with a sync flush and write it as a chunk, so it reaches the file
+// without the stream starting over and losing what it has learned.
+//
+// Every frameBytes of uncompressed data the stream is reset, which starts
+// a new frame. No frame depends on another, so a reader can start at any
+// frame, and a crash costs at most the chunk being written.
+//
+// The log goes to a series of files, base.0000.mpz, base.0001.mpz and
+// so on. A new file is started when the current one reaches maxBytes, or
+// when rotate() is called, e.g. at the start of each session. An existing
+// file is never written over.
+//
+// A chunk that can't be written is kept and tried again in a new file,
+// and isOpen() is false until it has been.
+//
+class CompressedSink : public ResultSink
+{
+public:
+    CompressedSink(const QString& baseName, qint64 maxBytes = 64 << 20,
+                   int frameBytes = 256 * 1024, int level = 6);
+    ~CompressedSink();
+
+    bool write(const char* data, int size);
+    bool flush();
+    bool sync();
+    bool rotate();
+    bool isOpen() {return !m_failed;}
+
+    QString currentFileName() const {return m_file.fileName();}
+    qint64 rawBytes() const {return m_rawTotal;}
+    qint64 compressedBytes() const {return m_compTotal;}
+
+private:
+    Q_DISABLE_COPY(CompressedSink)
+
+    QString m_baseName;
+    qint64 m_maxBytes;
+    int m_frameBytes;
+    int m_level;
+    int m_fileIndex;
+    QFile m_file;
+    z_stream_s* m_stream;       // Deflate state, 0 if it couldn't be made
+    QByteArray m_pending;       // Data for the next chunk
+    QByteArray m_comp;          // The chunk's compressed data
+    qint64 m_rawOffset;         // Uncompressed bytes in the current file
+    qint64 m_frameRaw;          // Uncompressed bytes in the current frame
+    qint64 m_rawTotal;          // Uncompressed bytes written, all files
+    qint64 m_compTotal;         // Compressed bytes written, all files
+    bool m_failed;              // The last chunk couldn't be written
+
+    bool writeChunk();
+    bool openNext();
+    QString fileName(int index) const;
+};
+
+//********************************************************************
+//
+// class CompressedLogReader
+//
+// Reads one file written by CompressedSink. open() reads only the chunk
+// headers. read() then inflates from the start of the frame holding the
+// offset asked for, up to the end of what was asked for.
+//
+class CompressedLogReader
+{
+public:
+    CompressedLogReader() {m_rawSize = 0;}
+
+    bool open(const QString& fileName);
+    void close();
+
+    qint64 size() const {return m_rawSize;}
+    int chunkCount() const {return m_chunks.size();}
+    QByteArray read(qint64 offset, qint64 length);
+    QByteArray readAll() {return read(0, m_rawSize);}
+
+private:
+    Q_DISABLE_COPY(CompressedLogReader)
+
+    struct Chunk
+    {
+        qint64 fileOffset;      // Of the compressed data
+        qint64 rawOffset;       // Of the chunk's first uncompressed byte
+        quint32 rawSize;
+        quint32 compSize;
+        quint32 check;
+        bool startsFrame;       // The stream was reset before this chunk
+    };
+
+    QFile m_file;
+    QVector<Chunk> m_chunks;
+    qint64 m_rawSize;
+
+    int findChunk(qint64 rawOffset) const;
+};
+
+#endif // COMPRESSEDLOG_H
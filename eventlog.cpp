@@ -0,0 +1,444 @@
+#include <QtCore>
+
+#include <testparm.h>
+#include <testparmmanager.h>
+#include <eventlog.h>
+
+#define EVENTLOG_MAGIC      0x5645504d  // "MPEV" read as little-endian
+#define EVENTLOG_VERSION    2
+
+static_assert(sizeof(EventRecord) == 32, "EventRecord layout changed");
+
+/***********************
+** EventLog Routines
+***********************/
+
+//*******************************************************************
+EventLog::EventLog()
+{
+    m_batchSize = 256;
+}
+
+//*******************************************************************
+// open
+//
+// Open a log for appending. A new, empty file is given a header record
+// first. An existing file must start with the header of a log of this
+// version, and a partial record left at its end by a crash is cut off,
+// so the records appended line up with those before.
+//
+// Returns false if the file can't be opened or isn't a log this version
+// can append to.
+//
+bool EventLog::open(const QString& fileName)
+{
+    close();
+
+    m_file.setFileName(fileName);
+    if(!m_file.open(QIODevice::ReadWrite | QIODevice::Append))
+        return false;
+
+    qint64 size = m_file.size();
+
+    if(size > 0) {
+        EventRecord hdr;
+
+        if(!m_file.seek(0)
+        || m_file.read((char*)&hdr, sizeof(hdr)) != sizeof(hdr)
+        || hdr.type != Header
+        || hdr.value[0] != EVENTLOG_MAGIC
+        || hdr.value[1] != EVENTLOG_VERSION
+        || hdr.value[2] != (qint32)sizeof(EventRecord)
+        || !m_file.resize(size - size % (qint64)sizeof(EventRecord))) {
+            m_file.close();
+            return false;
+        }
+    } else {
+        EventRecord rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.type = Header;
+        rec.value[0] = EVENTLOG_MAGIC;
+        rec.value[1] = EVENTLOG_VERSION;
+        rec.value[2] = sizeof(EventRecord);
+        append(rec, true);
+    }
+
+    m_clock.start();
+    return true;
+}
+
+//*******************************************************************
+void EventLog::close()
+{
+    if(!m_file.isOpen())
+        return;
+
+    commit();
+    m_file.close();
+}
+
+//*******************************************************************
+// sessionStart
+//
+// Log the start of a run, and start the clock the other records are
+// stamped by.
+//
+void EventLog::sessionStart(TestParmManager* ptm)
+{
+    EventRecord rec;
+
+    m_clock.start();
+    record(rec, SessionStart, ptm);
+    rec.stamp = QDateTime::currentMSecsSinceEpoch();
+    rec.value[0] = ptm->getTestParmList().size();
+    append(rec);
+}
+
+//*******************************************************************
+// problemIssued
+//
+// Log the problem for the current pass of the current test, with its
+// terms, four to a record, and its problem and correctAnswer text. Call
+// it once those are set.
+//
+void EventLog::problemIssued(TestParmManager* ptm, const QVector<int>& terms)
+{
+    EventRecord rec;
+    int count = qMin(terms.size(), 255);
+
+    record(rec, Problem, ptm);
+    rec.flags = (quint8)count;
+
+    for(int i = 0; i < count; i += 4) {
+        if(i > 0) {
+            record(rec, Terms, ptm);
+            rec.flags = (quint8)count;
+        }
+        for(int j = 0; j < 4 && i + j < count; ++j)
+            rec.terms[j] = terms[i + j];
+        append(rec);
+    }
+
+    if(count == 0)
+        append(rec);
+
+    TestParm* pt = ptm->getTestParm();
+    appendText(ptm, ProblemText, pt->problem);
+    appendText(ptm, CorrectText, pt->correctAnswer);
+}
+
+//*******************************************************************
+// answer
+//
+// Log the user's answer to the current problem. Call it after the
+// answer is checked and before updatePass().
+//
+void EventLog::answer(TestParmManager* ptm)
+{
+    EventRecord rec;
+    TestParm* pt = ptm->getTestParm();
+    QByteArray text = pt->userAnswer.toUtf8();
+
+    appendText(ptm, AnswerText, pt->userAnswer);
+
+    record(rec, Answer, ptm);
+    rec.flags = (pt->isCorrect ? Correct : 0) | (pt->isOnTime ? OnTime : 0);
+    rec.answer.nsecs = pt->userNsecs;
+    memcpy(rec.answer.text, text.constData(),
+           qMin(text.size(), (int)sizeof(rec.answer.text)));
+    append(rec);
+}
+
+//*******************************************************************
+// testEnd
+//
+// Log the score of the current test and commit the batch.
+//
+void EventLog::testEnd(TestParmManager* ptm)
+{
+    EventRecord rec;
+    TestParm* pt = ptm->getTestParm();
+
+    record(rec, TestEnd, ptm);
+    rec.value[0] = pt->numberCorrect;
+    rec.value[1] = pt->count;
+    rec.value[2] = pt->percentScore;
+    append(rec, true);
+}
+
+//*******************************************************************
+// sessionEnd
+//
+// Log the totals for the run and commit the batch.
+//
+void EventLog::sessionEnd(TestParmManager* ptm)
+{
+    EventRecord rec;
+    int correct = 0;
+    QList<TestParm*>& list = ptm->getTestParmList();
+
+    for(int i = 0; i < list.size(); ++i)
+        if(list[i]->isEnabled)
+            correct += list[i]->numberCorrect;
+
+    record(rec, SessionEnd, ptm);
+    rec.value[0] = ptm->getTotalCount();
+    rec.value[1] = correct;
+    append(rec, true);
+}
+
+//*******************************************************************
+// append
+//
+// Add a record to the batch, and commit the batch if it's full or if
+// asked to.
+//
+void EventLog::append(const EventRecord& rec, bool commitNow)
+{
+    m_batchLock.lock();
+    m_batch << rec;
+    bool full = m_batch.size() >= m_batchSize;
+    m_batchLock.unlock();
+
+    if(full || commitNow)
+        commit();
+}
+
+//*******************************************************************
+// commit
+//
+// Write all the waiting records with one write. Records appended while
+// the write is going on wait for the next commit.
+//
+// Returns false if the write failed. The records are lost.
+//
+bool EventLog::commit()
+{
+    QMutexLocker fileLocker(&m_fileLock);
+
+    m_batchLock.lock();
+    m_writing.swap(m_batch);
+    m_batchLock.unlock();
+
+    if(m_writing.isEmpty())
+        return true;
+
+    qint64 size = m_writing.size() * (qint64)sizeof(EventRecord);
+    bool ok = m_file.isOpen()
+           && m_file.write((const char*)m_writing.constData(), size) == size
+           && m_file.flush();
+
+    m_writing.clear();
+    return ok;
+}
+
+//*******************************************************************
+// record
+//
+// Start a record of the given type for the current test and pass.
+//
+void EventLog::record(EventRecord& rec, int type, TestParmManager* ptm)
+{
+    memset(&rec, 0, sizeof(rec));
+    rec.type = (quint8)type;
+    rec.test = (quint16)ptm->getIndex();
+    rec.pass = ptm->getPass();
+    rec.stamp = m_clock.isValid() ? m_clock.nsecsElapsed() : 0;
+}
+
+//*******************************************************************
+// appendText
+//
+// Log a text field of the current test as Text records, 16 bytes of
+// UTF-8 to a record. Empty text still takes one record.
+//
+void EventLog::appendText(TestParmManager* ptm, int field,
+                          const QString& text)
+{
+    QByteArray utf8 = text.toUtf8();
+    int pos = 0;
+
+    do {
+        EventRecord rec;
+        int n = qMin(utf8.size() - pos, (int)sizeof(rec.text));
+
+        record(rec, Text, ptm);
+        memcpy(rec.text, utf8.constData() + pos, n);
+        pos += n;
+        rec.flags = (quint8)(field | (n << TextLengthShift)
+                           | (pos < utf8.size() ? TextMore : 0));
+        append(rec);
+    } while(pos < utf8.size());
+}
+
+/**************************
+** Reading Routines
+**************************/
+
+//*******************************************************************
+// read
+//
+// Read every whole record of a log. A partial record at the end, left by
+// a crash mid-write, is dropped.
+//
+// Returns the number of records read, or -1 if the file can't be read or
+// doesn't start with a valid header.
+//
+int EventLog::read(const QString& fileName, QVector<EventRecord>& records)
+{
+    QFile file(fileName);
+
+    records.clear();
+    if(!file.open(QIODevice::ReadOnly))
+        return -1;
+
+    qint64 count = file.size() / (qint64)sizeof(EventRecord);
+    records.resize((int)count);
+
+    qint64 size = count * (qint64)sizeof(EventRecord);
+    if(file.read((char*)records.data(), size) != size) {
+        records.clear();
+        return -1;
+    }
+
+    if(count == 0 || records[0].type != Header
+    || records[0].value[0] != EVENTLOG_MAGIC
+    || records[0].value[1] < 1 || records[0].value[1] > EVENTLOG_VERSION
+    || records[0].value[2] != (qint32)sizeof(EventRecord)) {
+        records.clear();
+        return -1;
+    }
+
+    return records.size();
+}
+
+//*******************************************************************
+// replay
+//
+// Bring a TestParmManager to the state the log leaves it in: the pass,
+// problem, answers, timing and score of each test, and the current
+// test. The terms of each problem are skipped, as TestParm has nowhere
+// to keep them. The
+// manager must have the same tests as the one that wrote the log. The
+// answers are counted into its stats as they were the first time.
+//
+// Replay stops at the first record that makes no sense, such as an
+// unknown type or a test out of range, which is taken as a damaged tail.
+//
+// Returns the number of records applied.
+//
+int EventLog::replay(const QVector<EventRecord>& records, TestParmManager* ptm)
+{
+    QList<TestParm*>& list = ptm->getTestParmList();
+    QByteArray text;            // Text gathered from Text records
+    bool haveAnswer = false;    // The next Answer's text has been read
+    int applied = 0;
+
+    for(int i = 0; i < records.size(); ++i, ++applied) {
+        const EventRecord& rec = records[i];
+
+        if(rec.type != Header && rec.type != SessionStart
+        && rec.test >= list.size())
+            break;
+
+        switch(rec.type) {
+        case Header:
+        case Terms:
+            break;
+
+        case Text: {
+            int n = (rec.flags >> TextLengthShift) & 0x1f;
+            if(n > (int)sizeof(rec.text))
+                return applied;
+
+            text.append(rec.text, n);
+            if(rec.flags & TextMore)
+                break;
+
+            TestParm* pt = list[rec.test];
+            QString value = QString::fromUtf8(text);
+
+            switch(rec.flags & TextFieldMask) {
+            case ProblemText:
+                pt->problem = value;
+                break;
+            case CorrectText:
+                pt->correctAnswer = value;
+                break;
+            default:
+                pt->userAnswer = value;
+                haveAnswer = true;
+                break;
+            }
+            text.clear();
+            break;
+        }
+
+        case SessionStart:
+            for(int j = 0; j < list.size(); ++j) {
+                list[j]->pass = 0;
+                list[j]->numberCorrect = 0;
+                list[j]->isCorrect = false;
+                list[j]->percentScore = 0;
+            }
+            ptm->initTotalCorrect();
+            ptm->setIndex(0);
+            ptm->setRunning(true);
+            break;
+
+        case Problem:
+            ptm->setIndex(rec.test);
+            ptm->setPass(rec.pass);
+            break;
+
+        case Answer: {
+            TestParm* pt = list[rec.test];
+            ptm->setIndex(rec.test);
+            ptm->setPass(rec.pass);
+            pt->userNsecs = rec.answer.nsecs;
+            pt->userTime = rec.answer.nsecs / 1000000000;
+            if(!haveAnswer)
+                pt->userAnswer = QString::fromUtf8(rec.answer.text,
+                                     qstrnlen(rec.answer.text,
+                                              sizeof(rec.answer.text)));
+            haveAnswer = false;
+            pt->isCorrect = (rec.flags & Correct) != 0;
+            pt->isOnTime = (rec.flags & OnTime) != 0;
+            if(rec.flags & Correct)
+                ptm->bumpCorrect();
+            ptm->updatePass();
+            break;
+        }
+
+        case TestEnd:
+            ptm->setIndex(rec.test);
+            list[rec.test]->percentScore = rec.value[2];
+            break;
+
+        case SessionEnd:
+            ptm->stopTest();
+            break;
+
+        default:
+            return applied;
+        }
+    }
+    return applied;
+}
+
+//*******************************************************************
+// replay
+//
+// Read a log file and replay it into a TestParmManager.
+//
+// Returns the number of records applied, or -1 if the file isn't a log.
+//
+int EventLog::replay(const QString& fileName, TestParmManager* ptm)
+{
+    QVector<EventRecord> records;
+
+    if(read(fileName, records) < 0)
+        return -1;
+
+    return replay(records, ptm);
+}
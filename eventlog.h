@@ -0,0 +1,135 @@
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+
+#include <QFile>
+#include <QMutex>
+#include <QVector>
+#include <QElapsedTimer>
+
+class TestParmManager;
+
+//********************************************************************
+//
+// struct EventRecord
+//
+// One event in a test session, 32 bytes. Every record is the same size,
+// so a log is read by stepping through it, and a torn write at the end
+// of a log is cut off at the last whole record.
+//
+// type   - one of EventLog::Type
+// flags  - Correct and OnTime for an answer, term count for a problem,
+//          field and length for text
+// test   - index of the test in the TestParmManager
+// pass   - the pass of the test
+// stamp  - nsecs since the session started. For SessionStart, msecs
+//          since the epoch.
+//
+// The last 16 bytes depend on the type.
+//
+// Header       - value[0] magic, value[1] version, value[2] record size
+// SessionStart - value[0] number of tests
+// Problem      - terms[] the first four terms, flags the total count
+// Terms        - terms[] four more terms of the problem before
+// Text         - text[] up to 16 bytes of UTF-8 text. flags holds which
+//                field of the TestParm the text is for (TextField), the
+//                number of bytes used, and TextMore if the text goes on
+//                in the next Text record.
+// Answer       - answer.nsecs response time, answer.text the first 8
+//                bytes of the user's answer. The whole answer is in the
+//                Text records just before.
+// TestEnd      - value[0] correct, value[1] count, value[2] percent
+// SessionEnd   - value[0] total count, value[1] total correct
+//
+struct EventRecord
+{
+    quint8 type;
+    quint8 flags;
+    quint16 test;
+    qint32 pass;
+    qint64 stamp;
+    union {
+        qint32 value[4];
+        qint32 terms[4];
+        char text[16];
+        struct {
+            qint64 nsecs;
+            char text[8];
+        } answer;
+    };
+};
+
+//********************************************************************
+//
+// class EventLog
+//
+// Append-only binary log of a test session, kept alongside the text
+// results. The logging calls take a TestParmManager, the same as the
+// ResultFileManager calls, and turn its current state into records.
+//
+// Records are gathered into a batch and written together, when the batch
+// is full and at the end of each test and session. This is the group
+// commit: any number of threads may append, and while one commits the
+// others go on filling the next batch.
+//
+// replay() reads a log back into a TestParmManager that has been set up
+// with the same tests, leaving it as it was after the last record: the
+// pass, score and statistics of each test, and the problem, correct
+// answer, user's answer and result of the last problem of each.
+//
+class EventLog
+{
+public:
+    enum Type {
+        Header = 1, SessionStart, Problem, Terms, Answer, TestEnd, SessionEnd,
+        Text
+    };
+
+    enum { Correct = 0x01, OnTime = 0x02 };
+
+    // Text record flags: the field in bits 0-1, the length in bits 2-6
+    //
+    enum TextField { ProblemText, CorrectText, AnswerText };
+    enum { TextFieldMask = 0x03, TextLengthShift = 2, TextMore = 0x80 };
+
+    EventLog();
+    ~EventLog() {close();}
+
+    bool open(const QString& fileName);
+    void close();
+    bool isOpen() {return m_file.isOpen();}
+    void setBatchSize(int records) {m_batchSize = qMax(1, records);}
+
+    // Logging
+    //
+    void sessionStart(TestParmManager* ptm);
+    void problemIssued(TestParmManager* ptm, const QVector<int>& terms);
+    void answer(TestParmManager* ptm);
+    void testEnd(TestParmManager* ptm);
+    void sessionEnd(TestParmManager* ptm);
+
+    void append(const EventRecord& rec, bool commitNow = false);
+    bool commit();
+
+    // Reading
+    //
+    static int read(const QString& fileName, QVector<EventRecord>& records);
+    static int replay(const QVector<EventRecord>& records,
+                      TestParmManager* ptm);
+    static int replay(const QString& fileName, TestParmManager* ptm);
+
+private:
+    Q_DISABLE_COPY(EventLog)
+
+    QFile m_file;
+    QMutex m_batchLock;             // Guards m_batch
+    QMutex m_fileLock;              // Guards m_file, held while committing
+    QVector<EventRecord> m_batch;   // Records not yet written
+    QVector<EventRecord> m_writing; // The batch being written
+    int m_batchSize;                // Commit when this many are waiting
+    QElapsedTimer m_clock;          // Session time for stamps
+
+    void record(EventRecord& rec, int type, TestParmManager* ptm);
+    void appendText(TestParmManager* ptm, int field, const QString& text);
+};
+
+#endif // EVENTLOG_H
@@ -0,0 +1,399 @@
+#include <QtCore>
+#include <climits>
+#include <time.h>
+
+#include <factors.h>
+#include <numformat.h>
+#include <testparm.h>
+#include <exprgen.h>
+
+// Precedence of a node, for deciding where parentheses go.
+//
+static int precedence(const ExprNode& nd)
+{
+    switch(nd.oper) {
+    case tp::op_add:
+    case tp::op_sub:
+        return 1;
+    case tp::op_mul:
+    case tp::op_div:
+        return 2;
+    default:
+        return 3;
+    }
+}
+
+// Copy text into [first, last). Returns one past the last char written,
+// or 0 if it didn't fit.
+//
+static char* putText(char* first, char* last, const char* text, int size)
+{
+    if(first == 0 || last - first < size)
+        return 0;
+    memcpy(first, text, size);
+    return first + size;
+}
+
+/*********************************
+** ExpressionGenerator Routines
+*********************************/
+
+//*******************************************************************
+// ExpressionGenerator constructor
+//
+// The defaults are two to four terms from 1 to 12, with all four
+// operators.
+//
+ExpressionGenerator::ExpressionGenerator()
+    : m_rnd((int)time(0))
+{
+    m_stride = 0;
+    m_count = 0;
+    m_opMask = (1 << tp::op_add) | (1 << tp::op_sub)
+             | (1 << tp::op_mul) | (1 << tp::op_div);
+    m_minTerms = 2;
+    m_maxTerms = 4;
+    m_min = 1;
+    m_max = 12;
+    m_limit = INT_MAX;
+    m_nonNegative = false;
+}
+
+//*******************************************************************
+// setOperators
+//
+// mask - 1 << tp::op_add, tp::op_sub, tp::op_mul and tp::op_div, for
+//        each operator to use. Other operators are ignored.
+//
+void ExpressionGenerator::setOperators(uint mask)
+{
+    mask &= (1 << tp::op_add) | (1 << tp::op_sub)
+          | (1 << tp::op_mul) | (1 << tp::op_div);
+    m_opMask = mask ? mask : (1 << tp::op_add);
+}
+
+//*******************************************************************
+void ExpressionGenerator::setTerms(int minTerms, int maxTerms)
+{
+    m_minTerms = qBound(1, qMin(minTerms, maxTerms), (int)MaxTerms);
+    m_maxTerms = qBound(1, qMax(minTerms, maxTerms), (int)MaxTerms);
+}
+
+//*******************************************************************
+void ExpressionGenerator::setRange(int min, int max)
+{
+    m_min = qMin(min, max);
+    m_max = qMax(min, max);
+}
+
+//*******************************************************************
+// generate
+//
+// Replace the batch with count new expressions.
+//
+// Returns the number of expressions made.
+//
+int ExpressionGenerator::generate(int count)
+{
+    int vals[MaxTerms];
+    int ops[MaxTerms];
+
+    m_count = qMax(0, count);
+    m_stride = 2 * m_maxTerms;
+    m_nodes.resize(m_count * m_stride);
+
+    for(int i = 0; i < m_count; ++i) {
+        int base = i * m_stride;
+        int terms = makeTerms(vals, ops);
+        int top = build(base, vals, ops, terms);
+        quint8 f = evaluate(top);
+
+        ExprNode& hdr = m_nodes[base];
+        hdr.value = m_nodes[top].value;
+        hdr.left = top;
+        hdr.right = 2 * terms;
+        hdr.oper = ExprNode::Header;
+        hdr.flags = f;
+        hdr.reserved = 0;
+    }
+    return m_count;
+}
+
+//*******************************************************************
+// evaluate
+//
+// Work out the value of the tree at index, setting the value and flags
+// of each of its nodes.
+//
+// Returns the flags of the result, 0 if it is exact and within the
+// limit.
+//
+quint8 ExpressionGenerator::evaluate(int index)
+{
+    ExprNode& nd = m_nodes[index];
+
+    if(nd.oper == ExprNode::Leaf)
+        return nd.flags = 0;
+
+    quint8 f = evaluate(nd.left) | evaluate(nd.right);
+    qint64 a = m_nodes[nd.left].value;
+    qint64 b = m_nodes[nd.right].value;
+    qint64 r = 0;
+
+    switch(nd.oper) {
+    case tp::op_add:
+        r = a + b;
+        break;
+    case tp::op_sub:
+        r = a - b;
+        break;
+    case tp::op_mul:
+        r = a * b;
+        break;
+    case tp::op_div:
+        if(b == 0 || a % b != 0)
+            f |= ExprNode::Undefined;
+        else
+            r = a / b;
+        break;
+    default:
+        f |= ExprNode::Undefined;
+        break;
+    }
+
+    if(r > m_limit || r < -(qint64)m_limit)
+        f |= ExprNode::Overflow;
+
+    nd.value = f ? 0 : (qint32)r;
+    nd.flags = f;
+    return f;
+}
+
+//*******************************************************************
+// render
+//
+// Write an expression as UTF-8 into [first, last), e.g. "3 + 4 × 2".
+// Subtraction and negative numbers use the minus sign, U+2212.
+// Parentheses are only written where precedence needs them. MaxChars is
+// always enough room.
+//
+// Returns one past the last char written, or 0 if it didn't fit.
+//
+char* ExpressionGenerator::render(int expr, char* first, char* last) const
+{
+    return put(root(expr), first, last);
+}
+
+/************************
+** Private Routines
+************************/
+
+//*******************************************************************
+// makeTerms
+//
+// Choose the numbers and operators of one expression. ops[k] joins
+// vals[k] to what comes before it.
+//
+// Each new term is tried with an operator picked at random and, if the
+// expression would break a constraint, with each of the other operators
+// in turn. The value so far is kept as sum, the total of the finished
+// +/- groups, plus sign times group, the x/÷ group being built. Together
+// these cover every intermediate result of the expression.
+//
+// Returns the number of terms.
+//
+int ExpressionGenerator::makeTerms(int* vals, int* ops)
+{
+    int enabled[4];
+    int nOps = 0;
+
+    for(int op = tp::op_add; op <= tp::op_div; ++op)
+        if(m_opMask & (1 << op))
+            enabled[nOps++] = op;
+
+    int lo = m_nonNegative ? qMax(0, m_min) : m_min;
+    int hi = qMax(lo, m_max);
+    int want = m_rnd.IRandomX(m_minTerms, m_maxTerms);
+
+    qint64 sum = 0;
+    qint64 group = m_rnd.IRandomX(lo, hi);
+    int sign = 1;
+    int terms = 1;
+
+    vals[0] = (int)group;
+    ops[0] = tp::op_add;
+
+    for(; terms < want; ++terms) {
+        int start = m_rnd.IRandomX(0, nOps - 1);
+        bool placed = false;
+
+        for(int a = 0; a < nOps && !placed; ++a) {
+            int op = enabled[(start + a) % nOps];
+            qint64 s = sum;
+            qint64 g = group;
+            int sg = sign;
+            int t;
+
+            switch(op) {
+            case tp::op_add:
+            case tp::op_sub:
+                s = sum + sign * group;
+                t = m_rnd.IRandomX(lo, hi);
+                g = t;
+                sg = (op == tp::op_add) ? 1 : -1;
+                break;
+            case tp::op_mul:
+                t = m_rnd.IRandomX(lo, hi);
+                g = group * t;
+                break;
+            default:
+                t = pickDivisor(group, lo, hi);
+                if(t == 0)
+                    continue;
+                g = group / t;
+                break;
+            }
+
+            qint64 v = s + sg * g;
+            if(qAbs(s) > m_limit || qAbs(g) > m_limit || qAbs(v) > m_limit)
+                continue;
+            if(m_nonNegative && (v < 0 || g < 0))
+                continue;
+
+            sum = s;
+            group = g;
+            sign = sg;
+            vals[terms] = t;
+            ops[terms] = op;
+            placed = true;
+        }
+
+        if(!placed)
+            break;
+    }
+    return terms;
+}
+
+//*******************************************************************
+// pickDivisor
+//
+// Returns a divisor of dividend from min to max, chosen at random. 1 is
+// only chosen if nothing larger will do. Returns 0 if there is none.
+//
+int ExpressionGenerator::pickDivisor(qint64 dividend, int min, int max)
+{
+    int factors[Factors::MaxFactors];
+    int lo = qMax(min, 1);
+
+    if(lo > max)
+        return 0;
+    if(dividend == 0)
+        return m_rnd.IRandomX(lo, max);
+
+    int n = Factors::getFactors((int)qAbs(dividend), factors,
+                                Factors::MaxFactors);
+    int count = 0;
+
+    n = qMin(n, (int)Factors::MaxFactors);
+    for(int i = 0; i < n; ++i)
+        if(factors[i] >= lo && factors[i] <= max)
+            factors[count++] = factors[i];
+
+    if(count > 0)
+        return factors[m_rnd.IRandomX(0, count - 1)];
+    return lo == 1 ? 1 : 0;
+}
+
+//*******************************************************************
+// build
+//
+// Lay out the tree of an expression in its span of the arena, after
+// the header. x and ÷ bind tighter than + and -, and operators of the
+// same precedence go left to right.
+//
+// Returns the arena index of the root.
+//
+int ExpressionGenerator::build(int base, const int* vals, const int* ops,
+                               int terms)
+{
+    int next = base + 1;
+
+    auto add = [&](int oper, int value, int left, int right) {
+        ExprNode& nd = m_nodes[next];
+        nd.value = value;
+        nd.left = left;
+        nd.right = right;
+        nd.oper = (quint8)oper;
+        nd.flags = 0;
+        nd.reserved = 0;
+        return next++;
+    };
+
+    int expr = -1;
+    int exprOp = tp::op_add;
+    int group = add(ExprNode::Leaf, vals[0], -1, -1);
+
+    for(int k = 1; k < terms; ++k) {
+        int leaf = add(ExprNode::Leaf, vals[k], -1, -1);
+
+        if(ops[k] == tp::op_mul || ops[k] == tp::op_div) {
+            group = add(ops[k], 0, group, leaf);
+        } else {
+            expr = (expr < 0) ? group : add(exprOp, 0, expr, group);
+            exprOp = ops[k];
+            group = leaf;
+        }
+    }
+
+    return (expr < 0) ? group : add(exprOp, 0, expr, group);
+}
+
+//*******************************************************************
+// put
+//
+// Write the tree at index for render(). A child is put in parentheses
+// if it binds more loosely than its parent, or if it is the right
+// operand and binds the same, as in 8 - (3 - 1). A negative number is
+// always put in parentheses.
+//
+char* ExpressionGenerator::put(int index, char* first, char* last) const
+{
+    const ExprNode& nd = m_nodes[index];
+
+    if(nd.oper == ExprNode::Leaf) {
+        if(nd.value >= 0)
+            return first ? nf::toChars(first, last, (qint64)nd.value) : 0;
+
+        first = putText(first, last, "(\xe2\x88\x92", 4);
+        if(first)
+            first = nf::toChars(first, last, 0 - (quint64)(qint64)nd.value);
+        return putText(first, last, ")", 1);
+    }
+
+    static const char* const signs[] = {
+        " + ", " \xe2\x88\x92 ", " \xc3\x97 ", " \xc3\xb7 "
+    };
+    static const int sizes[] = {3, 5, 4, 4};
+
+    int prec = precedence(nd);
+    const ExprNode& left = m_nodes[nd.left];
+    const ExprNode& right = m_nodes[nd.right];
+    bool parenLeft = precedence(left) < prec;
+    bool parenRight = precedence(right) <= prec;
+
+    if(parenLeft)
+        first = putText(first, last, "(", 1);
+    first = first ? put(nd.left, first, last) : 0;
+    if(parenLeft)
+        first = putText(first, last, ")", 1);
+
+    first = putText(first, last, signs[nd.oper], sizes[nd.oper]);
+
+    if(parenRight)
+        first = putText(first, last, "(", 1);
+    first = first ? put(nd.right, first, last) : 0;
+    if(parenRight)
+        first = putText(first, last, ")", 1);
+
+    return first;
+}
@@ -0,0 +1,109 @@
+#ifndef EXPRGEN_H
+#define EXPRGEN_H
+
+#include <QVector>
+#include <randomc.h>
+
+//********************************************************************
+//
+// struct ExprNode
+//
+// One node of an expression tree. Nodes refer to their children by
+// index in the generator's arena rather than by pointer, so a whole
+// batch of trees is one flat array.
+//
+// value - the number of a Leaf, or the result once evaluated
+// left  - arena index of the left operand, -1 for a Leaf
+// right - arena index of the right operand, -1 for a Leaf
+// oper  - tp::oper_t of the operation, or Leaf
+// flags - Overflow if the result went past the limit, Undefined for a
+//         division by zero or one that doesn't come out even
+//
+struct ExprNode
+{
+    enum {Leaf = 0xff, Header = 0xfe};
+    enum {Overflow = 0x01, Undefined = 0x02};
+
+    qint32 value;
+    qint32 left;
+    qint32 right;
+    quint8 oper;
+    quint8 flags;
+    quint16 reserved;
+};
+
+static_assert(sizeof(ExprNode) == 16, "ExprNode layout changed");
+
+//********************************************************************
+//
+// class ExpressionGenerator
+//
+// Makes batches of expressions that mix +, -, x and / with the usual
+// precedence, such as 3 + 4 x 2 - 5, and their exact answers.
+//
+// Every expression of a batch is built in one arena, a QVector of
+// ExprNodes with a fixed span for each expression. Its first node is a
+// Header holding the answer (value), the root (left) and the number of
+// nodes used (right). Nothing is allocated per node. Once the arena has
+// grown to fit a batch, later batches no larger allocate nothing.
+//
+// Each term is checked as it is added, in 64 bits, so the expression
+// so far never goes past the limit. With setNonNegative(), its value
+// never drops below 0 either. Divisors are taken from the factors of
+// the term being divided, so every division comes out even. If no
+// operator can take another term within the constraints, the expression
+// ends with fewer terms.
+//
+// evaluate() works out any tree in the arena again, flagging overflow
+// and uneven division. render() writes an expression as UTF-8 into a
+// caller's buffer, in the manner of nf::toChars.
+//
+class ExpressionGenerator
+{
+public:
+    enum {MaxTerms = 8};
+    enum {MaxChars = 176};      // Longest render() of MaxTerms terms
+
+    ExpressionGenerator();
+
+    void setOperators(uint mask);
+    void setTerms(int minTerms, int maxTerms);
+    void setRange(int min, int max);
+    void setLimit(int maxAbs) {m_limit = qMax(1, maxAbs);}
+    void setNonNegative(bool nonNegative) {m_nonNegative = nonNegative;}
+
+    int generate(int count);
+
+    int size() const {return m_count;}
+    int answer(int expr) const {return header(expr).value;}
+    int flags(int expr) const {return header(expr).flags;}
+    int root(int expr) const {return header(expr).left;}
+    int terms(int expr) const {return header(expr).right / 2;}
+    const ExprNode& node(int index) const {return m_nodes[index];}
+
+    quint8 evaluate(int index);
+    char* render(int expr, char* first, char* last) const;
+
+private:
+    QVector<ExprNode> m_nodes;  // The arena
+    int m_stride;               // Nodes in each expression's span
+    int m_count;                // Expressions in the current batch
+    uint m_opMask;              // 1 << tp::oper_t of each operator used
+    int m_minTerms;
+    int m_maxTerms;
+    int m_min;                  // Range of the numbers in the terms
+    int m_max;
+    int m_limit;                // Largest magnitude of any result
+    bool m_nonNegative;         // No result may be negative
+    CRandomMersenne m_rnd;
+
+    const ExprNode& header(int expr) const
+        {return m_nodes[expr * m_stride];}
+
+    int makeTerms(int* vals, int* ops);
+    int pickDivisor(qint64 dividend, int min, int max);
+    int build(int base, const int* vals, const int* ops, int terms);
+    char* put(int index, char* first, char* last) const;
+};
+
+#endif // EXPRGEN_H
@@ -1,41 +1,151 @@
+#include "numtheory.h"
 #include "factors.h"
 
 Factors::Factors()
 {
+    m_gcf_exists = false;
 }
 
 Factors::Factors(int a, int b)
 {
-    m_avec.clear();
-    m_bvec.clear();
     getCommonFactors(a, b);
 }
 
 QVector<int> Factors::getCommonFactors(int a, int b)
 {
-    m_avec = getFactors(a);
-    m_bvec = getFactors(b);
-    int count = m_avec.size() > m_bvec.size() ? m_bvec.size() : m_avec.size();
+    int buf[MaxFactors];
+    int count = getCommonFactors(a, b, buf, MaxFactors);
 
-    for(int i = 0; i < count; ++i) {
-        if((m_avec[i] != 0) && (m_bvec[i] != 0) && (m_avec[i] == m_bvec[i]))
-            m_facvec << m_avec[i];
-    }
+    m_facvec.clear();
+    for(int i = 0; i < count; ++i)
+        m_facvec << buf[i];
 
     m_gcf_exists = !m_facvec.isEmpty();
     return m_facvec;
 }
 
-QVector<int> Factors::getFactors(int x)
+///////////////////////////////////////////////////////////////////////////////
+//
+// getFactors
+//	Find all the factors of x that are greater than 1, in ascending
+//	order. Factors come in pairs, i and x/i, so only the numbers up to
+//	the square root of x need to be tried. Small numbers are looked up
+//	in a table built at compile time.
+//
+// Arguments
+//	x    - the number to factor
+//	buf  - caller's buffer to receive the factors
+//	size - number of ints buf can hold
+//
+// Returns the number of factors of x. If that is more than size, only
+// the first size factors are written.
+//
+int Factors::getFactors(int x, int* buf, int size)
 {
-    static QVector<int> vec;
-    vec.clear();
+    int low[MaxFactors / 2];    // factors up to the square root of x
+    int lowCount = 0;
+    int count = 0;
+
+    if(x < 2)
+        return 0;
+
+    if(x <= nt::FactorTableMax) {
+        const nt::DivisorTable<nt::FactorTableMax>& table =
+                nt::divisorTable<nt::FactorTableMax>;
 
-    for(int i = 2; i <= x; ++i) {
+        // Skip the leading 1
+        //
+        count = table.count(x) - 1;
+        for(int i = 0; i < count && i < size; ++i)
+            buf[i] = table.divisor(x, i + 1);
+        return count;
+    }
+
+    for(int i = 2; i <= x / i; ++i) {
         if(x % i == 0)
-            vec << i;
-        else
-            vec << 0;
+            low[lowCount++] = i;
+    }
+
+    for(int i = 0; i < lowCount; ++i, ++count) {
+        if(count < size)
+            buf[count] = low[i];
+    }
+
+    // Now the cofactors, walking back down from the square root. A
+    // perfect square's root was already stored above. Finally, x itself.
+    //
+    for(int i = lowCount - 1; i >= 0; --i) {
+        int high = x / low[i];
+        if(high == low[i])
+            continue;
+        if(count < size)
+            buf[count] = high;
+        ++count;
+    }
+
+    if(count < size)
+        buf[count] = x;
+
+    return count + 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// getCommonFactors
+//	The common factors of a and b are exactly the factors of their
+//	greatest common factor, so find that first and factor it.
+//
+// Arguments
+//	a, b - the numbers to compare
+//	buf  - caller's buffer to receive the common factors
+//	size - number of ints buf can hold
+//
+// Returns the number of common factors greater than 1.
+//
+int Factors::getCommonFactors(int a, int b, int* buf, int size)
+{
+    if(a < 2 || b < 2)
+        return 0;
+
+    return getFactors(getGreatestComFactor(a, b), buf, size);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// getGreatestComFactor
+//	Euclid's algorithm.
+//
+// Returns the greatest common factor of a and b, or 1 if there is none.
+//
+int Factors::getGreatestComFactor(int a, int b)
+{
+    if(a < 2 || b < 2)
+        return 1;
+
+    while(b != 0) {
+        int r = a % b;
+        a = b;
+        b = r;
     }
-    return vec;
+    return a;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// getCommonFactors
+//	Same as above, but uses a scratch buffer that belongs to the calling
+//	thread. The results are good until the same thread calls this again.
+//
+// Arguments
+//	a, b  - the numbers to compare
+//	count - receives the number of common factors
+//
+// Returns a pointer to the common factors.
+//
+const int* Factors::getCommonFactors(int a, int b, int& count)
+{
+    static thread_local int scratch[MaxFactors];
+
+    count = getCommonFactors(a, b, scratch, MaxFactors);
+    return scratch;
 }
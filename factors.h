@@ -6,23 +6,56 @@
 QT_BEGIN_NAMESPACE
 QT_END_NAMESPACE
 
-
+//********************************************************************
+//
+// class Factors
+//
+// Finds the common factors and the greatest common factor of two
+// integers.
+//
+// The static functions keep no state and write into a buffer supplied
+// by the caller, so any number of threads can call them at once without
+// locking and without touching the heap. MaxFactors is the most factors
+// any positive int can have, so a buffer of that size is always enough.
+//
+// The member functions are kept for existing callers. They store their
+// results in the object, so each thread must use its own instance.
+//
+// The 64-bit overloads (factors64.cpp) reach past the range of trial
+// division. Primes are found with a deterministic Miller-Rabin test and
+// composites are split with Brent's variant of Pollard's rho, both done
+// in Montgomery arithmetic. Small numbers are factored from a sieve.
+//
 class Factors
 {
 public:
+    enum { MaxFactors = 1600 };     // Most divisors of any int < 2^31
+    enum { MaxPrimeFactors = 64 };  // Most prime factors of a 64-bit number
+
     Factors();
     Factors(int a, int b);
     QVector<int> getCommonFactors(int a, int b);
     int getGreatestComFactor() {return m_gcf_exists ? m_facvec.last() : 1;}
     bool existCommonFactors() {return m_gcf_exists;}
 
-private:
-    QVector<int> getFactors(int x);
+    // Reentrant interface
+    //
+    static int getFactors(int x, int* buf, int size);
+    static int getCommonFactors(int a, int b, int* buf, int size);
+    static int getGreatestComFactor(int a, int b);
+    static const int* getCommonFactors(int a, int b, int& count);
 
-    QVector<int> m_avec;                // FactorsA
-    QVector<int> m_bvec;                // FactorsB
+    // Reentrant 64-bit interface
+    //
+    static bool isPrime(quint64 n);
+    static int getPrimeFactors(quint64 n, quint64* buf, int size);
+    static QVector<quint64> getPrimeFactors(quint64 n);
+    static int getFactors(quint64 x, quint64* buf, int size);
+    static int getCommonFactors(quint64 a, quint64 b, quint64* buf, int size);
+    static quint64 getGreatestComFactor(quint64 a, quint64 b);
+
+private:
     QVector<int> m_facvec;              // Common Factors
-    int m_gcf;                          // Greatest Common Factor
     bool m_gcf_exists;
 };
 
@@ -0,0 +1,436 @@
+// 64-bit factoring for class Factors.
+//
+// Numbers below SIEVE_LIMIT are factored by looking up their smallest
+// prime factor in a table built once on first use. Larger numbers are
+// tested with Miller-Rabin and split with Pollard-Brent rho. Both run in
+// Montgomery form, which turns every modular multiply into two 64x64
+// multiplies and a subtract, with no division.
+//
+// Everything here works on locals and caller buffers. The sieve table is
+// read-only once built, and C++11 makes building it thread safe.
+//
+
+#include <QtGlobal>
+#include <QtAlgorithms>
+#include <algorithm>
+#include "factors.h"
+
+#define SIEVE_LIMIT (1 << 16)   // Numbers below this use the sieve
+#define RHO_BATCH   128         // Rho steps between gcd evaluations
+
+namespace {
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// mulhi - high 64 bits of the 128-bit product a * b
+//
+inline quint64 mulhi(quint64 a, quint64 b)
+{
+#if defined(__SIZEOF_INT128__)
+    return (quint64)(((unsigned __int128)a * b) >> 64);
+#else
+    quint64 aLo = (quint32)a, aHi = a >> 32;
+    quint64 bLo = (quint32)b, bHi = b >> 32;
+    quint64 lolo = aLo * bLo;
+    quint64 hilo = aHi * bLo;
+    quint64 lohi = aLo * bHi;
+    quint64 mid = (lolo >> 32) + (quint32)hilo + (quint32)lohi;
+    return aHi * bHi + (hilo >> 32) + (lohi >> 32) + (mid >> 32);
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// class Montgomery
+//
+// Arithmetic modulo an odd n in Montgomery form, where x is held as
+// x * 2^64 mod n. Values passed to and returned by mul(), add() and sub()
+// are all in that form.
+//
+class Montgomery
+{
+public:
+    Montgomery(quint64 n) : m_n(n)
+    {
+        // Newton's iteration for n^-1 mod 2^64. Each pass doubles the
+        // number of correct bits, and n itself is right to 3 bits.
+        //
+        quint64 inv = n;
+        for(int i = 0; i < 5; ++i)
+            inv *= 2 - n * inv;
+        m_inv = inv;
+
+        // 2^64 mod n, then 2^128 mod n by doubling it 64 more times.
+        //
+        m_one = (0 - n) % n;
+        m_r2 = m_one;
+        for(int i = 0; i < 64; ++i)
+            m_r2 = add(m_r2, m_r2);
+    }
+
+    quint64 one() const {return m_one;}
+    quint64 toMont(quint64 a) const {return mul(a % m_n, m_r2);}
+
+    quint64 mul(quint64 a, quint64 b) const
+    {
+        quint64 lo = a * b;
+        quint64 hi = mulhi(a, b);
+        quint64 m = lo * m_inv;
+        quint64 t = mulhi(m, m_n);
+        return (hi >= t) ? hi - t : hi - t + m_n;
+    }
+
+    quint64 add(quint64 a, quint64 b) const
+    {
+        quint64 s = a + b;
+        return (s < a || s >= m_n) ? s - m_n : s;
+    }
+
+    quint64 sub(quint64 a, quint64 b) const
+    {
+        return (a >= b) ? a - b : a - b + m_n;
+    }
+
+    quint64 pow(quint64 base, quint64 exp) const
+    {
+        quint64 result = m_one;
+        while(exp) {
+            if(exp & 1)
+                result = mul(result, base);
+            base = mul(base, base);
+            exp >>= 1;
+        }
+        return result;
+    }
+
+private:
+    quint64 m_n;        // The modulus, which must be odd
+    quint64 m_inv;      // n^-1 mod 2^64
+    quint64 m_one;      // 1 in Montgomery form, 2^64 mod n
+    quint64 m_r2;       // 2^128 mod n, used to convert into the form
+};
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// gcd - binary gcd, using only shifts and subtracts
+//
+inline quint64 gcd(quint64 a, quint64 b)
+{
+    if(a == 0)
+        return b;
+    if(b == 0)
+        return a;
+
+    int shift = qCountTrailingZeroBits(a | b);
+    a >>= qCountTrailingZeroBits(a);
+
+    while(b != 0) {
+        b >>= qCountTrailingZeroBits(b);
+        if(a > b)
+            std::swap(a, b);
+        b -= a;
+    }
+    return a << shift;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// smallestFactorTable - smallest prime factor of every number below
+// SIEVE_LIMIT, built by a sieve on first use.
+//
+const quint16* smallestFactorTable()
+{
+    static const struct Table {
+        quint16 spf[SIEVE_LIMIT];
+
+        Table()
+        {
+            for(int i = 0; i < SIEVE_LIMIT; ++i)
+                spf[i] = 0;
+
+            for(int i = 2; i < SIEVE_LIMIT; ++i) {
+                if(spf[i] != 0)
+                    continue;
+                for(int j = i; j < SIEVE_LIMIT; j += i)
+                    if(spf[j] == 0)
+                        spf[j] = (quint16)i;
+            }
+        }
+    } table;
+
+    return table.spf;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// millerRabin - deterministic primality test for odd n > 2
+//
+// These seven bases, found by Jim Sinclair, leave no strong pseudoprime
+// below 2^64.
+//
+bool millerRabin(quint64 n)
+{
+    static const quint64 bases[] =
+        {2, 325, 9375, 28178, 450775, 9780504, 1795265022};
+
+    Montgomery mont(n);
+    quint64 d = n - 1;
+    int s = qCountTrailingZeroBits(d);
+    d >>= s;
+
+    quint64 one = mont.one();
+    quint64 minusOne = mont.sub(0, one);
+
+    for(unsigned i = 0; i < sizeof(bases) / sizeof(bases[0]); ++i) {
+        quint64 a = bases[i] % n;
+        if(a == 0)
+            continue;
+
+        quint64 x = mont.pow(mont.toMont(a), d);
+        if(x == one || x == minusOne)
+            continue;
+
+        int r = 1;
+        for(; r < s; ++r) {
+            x = mont.mul(x, x);
+            if(x == minusOne)
+                break;
+        }
+        if(r == s)
+            return false;
+    }
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// pollardBrent - find a nontrivial factor of an odd composite n
+//
+// Brent's cycle finding on x -> x^2 + c. Differences are multiplied
+// together and a gcd is taken only every RHO_BATCH steps. If a batch
+// overshoots, it is replayed one step at a time. If a walk fails
+// outright, it is tried again with the next c.
+//
+quint64 pollardBrent(quint64 n)
+{
+    Montgomery mont(n);
+
+    for(quint64 c = 1; ; ++c) {
+        quint64 cm = mont.toMont(c);
+        quint64 y = mont.toMont(2);
+        quint64 x = y;
+        quint64 ys = y;
+        quint64 q = mont.one();
+        quint64 g = 1;
+
+        for(quint64 r = 1; g == 1; r <<= 1) {
+            x = y;
+            for(quint64 i = 0; i < r; ++i)
+                y = mont.add(mont.mul(y, y), cm);
+
+            for(quint64 k = 0; k < r && g == 1; k += RHO_BATCH) {
+                ys = y;
+                quint64 steps = qMin((quint64)RHO_BATCH, r - k);
+                for(quint64 i = 0; i < steps; ++i) {
+                    y = mont.add(mont.mul(y, y), cm);
+                    q = mont.mul(q, mont.sub(x, y));
+                }
+                g = gcd(q, n);
+            }
+        }
+
+        if(g == n) {
+            do {
+                ys = mont.add(mont.mul(ys, ys), cm);
+                g = gcd(mont.sub(x, ys), n);
+            } while(g == 1);
+        }
+
+        if(g != n)
+            return g;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// factorInto - append the prime factors of n to buf
+//
+// count is the number of factors found so far. Factors past size are
+// counted but not stored.
+//
+void factorInto(quint64 n, quint64* buf, int size, int& count)
+{
+    while(n > 1) {
+        quint64 p;
+
+        if(n < SIEVE_LIMIT) {
+            p = smallestFactorTable()[n];
+        } else if(millerRabin(n)) {
+            p = n;
+        } else {
+            p = pollardBrent(n);
+            factorInto(p, buf, size, count);
+            n /= p;
+            continue;
+        }
+
+        if(count < size)
+            buf[count] = p;
+        ++count;
+        n /= p;
+    }
+}
+
+} // namespace
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// isPrime
+//
+// Returns true if n is prime.
+//
+bool Factors::isPrime(quint64 n)
+{
+    if(n < SIEVE_LIMIT)
+        return n >= 2 && smallestFactorTable()[n] == n;
+
+    if((n & 1) == 0)
+        return false;
+
+    return millerRabin(n);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// getPrimeFactors
+//	Find the prime factorization of n, with repeated factors listed as
+//	many times as they divide n, in ascending order.
+//
+// Arguments
+//	n    - the number to factor
+//	buf  - caller's buffer to receive the factors
+//	size - number of quint64s buf can hold. MaxPrimeFactors is always
+//	       enough.
+//
+// Returns the number of prime factors, or 0 if n < 2.
+//
+int Factors::getPrimeFactors(quint64 n, quint64* buf, int size)
+{
+    int count = 0;
+
+    if(n < 2)
+        return 0;
+
+    // Take out the twos here so everything left over is odd, which
+    // Montgomery form requires.
+    //
+    int twos = qCountTrailingZeroBits(n);
+    for(; count < twos; ++count)
+        if(count < size)
+            buf[count] = 2;
+    n >>= twos;
+
+    factorInto(n, buf, size, count);
+    std::sort(buf, buf + qMin(count, size));
+    return count;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// getPrimeFactors
+//	Convenience overload for callers that want a QVector.
+//
+QVector<quint64> Factors::getPrimeFactors(quint64 n)
+{
+    quint64 buf[MaxPrimeFactors];
+    int count = getPrimeFactors(n, buf, MaxPrimeFactors);
+
+    QVector<quint64> vec;
+    for(int i = 0; i < count; ++i)
+        vec << buf[i];
+    return vec;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// getFactors
+//	Find all the factors of x that are greater than 1, in ascending
+//	order, by combining the powers of its prime factors.
+//
+// Arguments
+//	x    - the number to factor
+//	buf  - caller's buffer to receive the factors
+//	size - number of quint64s buf can hold
+//
+// Returns the number of factors of x. Unlike the int version, nothing is
+// written if that is more than size, because the factors come out of
+// order and can't be sorted without room for all of them.
+//
+int Factors::getFactors(quint64 x, quint64* buf, int size)
+{
+    quint64 primes[MaxPrimeFactors];
+    int count = getPrimeFactors(x, primes, MaxPrimeFactors);
+    int total = 1;
+
+    if(count == 0)
+        return 0;
+
+    for(int i = 0, run = 1; i < count; ++i, ++run) {
+        if(i + 1 == count || primes[i + 1] != primes[i]) {
+            total *= run + 1;
+            run = 0;
+        }
+    }
+
+    if(total - 1 > size)
+        return total - 1;
+
+    // Build every divisor but 1. Each distinct prime power p^e adds p,
+    // p^2, ... p^e, each also times every divisor found before it.
+    //
+    int found = 0;
+    for(int i = 0; i < count;) {
+        quint64 p = primes[i];
+        int prev = found;
+        quint64 pk = 1;
+
+        for(; i < count && primes[i] == p; ++i) {
+            pk *= p;
+            buf[found++] = pk;
+            for(int j = 0; j < prev; ++j)
+                buf[found++] = buf[j] * pk;
+        }
+    }
+
+    std::sort(buf, buf + found);
+    return found;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// getCommonFactors
+//
+// Returns the number of common factors greater than 1. See getFactors
+// above for what happens when buf is too small.
+//
+int Factors::getCommonFactors(quint64 a, quint64 b, quint64* buf, int size)
+{
+    if(a < 2 || b < 2)
+        return 0;
+
+    return getFactors(getGreatestComFactor(a, b), buf, size);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// getGreatestComFactor
+//
+// Returns the greatest common factor of a and b, or 1 if there is none.
+//
+quint64 Factors::getGreatestComFactor(quint64 a, quint64 b)
+{
+    if(a < 2 || b < 2)
+        return 1;
+
+    return gcd(a, b);
+}
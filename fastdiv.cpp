@@ -0,0 +1,54 @@
+#include <fastdiv.h>
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// divide - quotients and remainders for a whole array of dividends
+//
+// n     - the dividends
+// quot  - receives n[i] / divisor, or 0 if not wanted
+// rem   - receives n[i] % divisor, or 0 if not wanted
+// count - number of dividends
+//
+// Each loop does only one thing, with no branches in the body, so the
+// compiler is free to unroll and vectorize it.
+//
+void FastDivisor::divide(const int* n, int* quot, int* rem, int count) const
+{
+    if(quot) {
+        for(int i = 0; i < count; ++i)
+            quot[i] = quotient(n[i]);
+    }
+
+    if(rem) {
+        for(int i = 0; i < count; ++i)
+            rem[i] = remainder(n[i]);
+    }
+}
+
+void FastDivisor::divide(const quint32* n, quint32* quot, quint32* rem,
+                         int count) const
+{
+    if(quot) {
+        for(int i = 0; i < count; ++i)
+            quot[i] = quotient(n[i]);
+    }
+
+    if(rem) {
+        for(int i = 0; i < count; ++i)
+            rem[i] = remainder(n[i]);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// countDivisible - how many of the dividends the divisor goes into evenly
+//
+int FastDivisor::countDivisible(const int* n, int count) const
+{
+    int hits = 0;
+
+    for(int i = 0; i < count; ++i)
+        hits += divides(n[i]) ? 1 : 0;
+
+    return hits;
+}
@@ -0,0 +1,106 @@
+#ifndef FASTDIV_H
+#define FASTDIV_H
+
+#include <QtGlobal>
+
+//********************************************************************
+//
+// class FastDivisor
+//
+// Division by a divisor that doesn't change, e.g. a whole "divide by 7"
+// worksheet. The constructor does the one real division. After that,
+// each quotient or remainder costs a couple of multiplies and no divide
+// instruction.
+//
+// This is Lemire's method (Lemire, Kaser & Kurz, "Faster Remainder by
+// Direct Computation", 2019). M = ceil(2^64 / d) is kept. For n < 2^32,
+// the high 64 bits of M * n are n / d. The low 64 bits are the fraction
+// left over, and the high bits of that times d are n % d. The low bits
+// also tell whether d divides n without working out the remainder.
+//
+// The int functions follow C's rules: quotients truncate toward zero and
+// the remainder takes the sign of the dividend. The divisor must not be
+// 0.
+//
+class FastDivisor
+{
+public:
+    FastDivisor() {init(1);}
+    explicit FastDivisor(int d) {init(d);}
+
+    void init(int d)
+    {
+        m_divisor = d;
+        m_abs = d < 0 ? 0u - (quint32)d : (quint32)d;
+        m_magic = (m_abs > 1) ? ~quint64(0) / m_abs + 1 : 0;
+    }
+
+    int divisor() const {return m_divisor;}
+
+    // Unsigned kernels.
+    //
+    quint32 quotient(quint32 n) const
+    {
+        return m_abs == 1 ? n : (quint32)mulhi(m_magic, n);
+    }
+
+    quint32 remainder(quint32 n) const
+    {
+        return m_abs == 1 ? 0 : (quint32)mulhi(m_magic * n, m_abs);
+    }
+
+    bool divides(quint32 n) const
+    {
+        return m_abs == 1 || m_magic * n <= m_magic - 1;
+    }
+
+    // Signed versions, with C semantics.
+    //
+    int quotient(int n) const
+    {
+        quint32 q = quotient(n < 0 ? 0u - (quint32)n : (quint32)n);
+        return ((n < 0) != (m_divisor < 0)) ? (int)(0u - q) : (int)q;
+    }
+
+    int remainder(int n) const
+    {
+        quint32 r = remainder(n < 0 ? 0u - (quint32)n : (quint32)n);
+        return n < 0 ? -(int)r : (int)r;
+    }
+
+    bool divides(int n) const
+    {
+        return divides(n < 0 ? 0u - (quint32)n : (quint32)n);
+    }
+
+    // Batch versions. Either output array may be 0 if not wanted.
+    //
+    void divide(const int* n, int* quot, int* rem, int count) const;
+    void divide(const quint32* n, quint32* quot, quint32* rem,
+                int count) const;
+    int countDivisible(const int* n, int count) const;
+
+    // High 64 bits of the 128-bit product a * b, for any compiler.
+    //
+    static quint64 mulhi(quint64 a, quint64 b)
+    {
+#if defined(__SIZEOF_INT128__)
+        return (quint64)(((unsigned __int128)a * b) >> 64);
+#else
+        quint64 aLo = (quint32)a, aHi = a >> 32;
+        quint64 bLo = (quint32)b, bHi = b >> 32;
+        quint64 lolo = aLo * bLo;
+        quint64 hilo = aHi * bLo;
+        quint64 lohi = aLo * bHi;
+        quint64 mid = (lolo >> 32) + (quint32)hilo + (quint32)lohi;
+        return aHi * bHi + (hilo >> 32) + (lohi >> 32) + (mid >> 32);
+#endif
+    }
+
+private:
+    int m_divisor;      // The divisor as given
+    quint32 m_abs;      // Its magnitude
+    quint64 m_magic;    // ceil(2^64 / m_abs), 0 when m_abs is 1
+};
+
+#endif // FASTDIV_H
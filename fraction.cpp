@@ -0,0 +1,327 @@
+#include <climits>
+#include <numformat.h>
+#include <factors.h>
+#include <fastdiv.h>
+#include <fraction.h>
+
+namespace {
+
+inline quint64 absval(qint64 v)
+{
+    return v < 0 ? 0 - (quint64)v : (quint64)v;
+}
+
+inline qint64 gcd(qint64 a, qint64 b)
+{
+    return (qint64)Factors::getGreatestComFactor(absval(a), absval(b));
+}
+
+// The overflow checks use the compiler's builtins where there are any,
+// and otherwise work it out from the 128-bit product or the signs.
+//
+inline bool mulOverflow(qint64 a, qint64 b, qint64* r)
+{
+#if defined(__GNUC__)
+    return __builtin_mul_overflow(a, b, r);
+#else
+    quint64 ua = absval(a), ub = absval(b);
+    quint64 lo = ua * ub;
+    bool neg = (a < 0) != (b < 0);
+
+    *r = (qint64)(neg ? 0 - lo : lo);
+    return FastDivisor::mulhi(ua, ub) != 0
+        || lo > (quint64)LLONG_MAX + (neg ? 1 : 0);
+#endif
+}
+
+inline bool addOverflow(qint64 a, qint64 b, qint64* r)
+{
+#if defined(__GNUC__)
+    return __builtin_add_overflow(a, b, r);
+#else
+    *r = (qint64)((quint64)a + (quint64)b);
+    return ((a ^ *r) & (b ^ *r)) < 0;
+#endif
+}
+
+// Compares x1 * y1 with x2 * y2 as 128-bit products.
+//
+inline int compareProducts(quint64 x1, quint64 y1, quint64 x2, quint64 y2)
+{
+    quint64 hi1 = FastDivisor::mulhi(x1, y1);
+    quint64 hi2 = FastDivisor::mulhi(x2, y2);
+
+    if(hi1 != hi2)
+        return hi1 < hi2 ? -1 : 1;
+
+    quint64 lo1 = x1 * y1;
+    quint64 lo2 = x2 * y2;
+    return (lo1 > lo2) - (lo1 < lo2);
+}
+
+} // namespace
+
+/***********************
+** Fraction Routines
+***********************/
+
+//*******************************************************************
+// normalize
+//
+// Reduce to lowest terms and move the sign to the numerator. LLONG_MIN
+// is refused in either place, because it has no positive counterpart.
+//
+// Returns false if the fraction is not valid.
+//
+bool Fraction::normalize()
+{
+    if(m_den == 0 || m_den == LLONG_MIN || m_num == LLONG_MIN) {
+        setInvalid();
+        return false;
+    }
+
+    if(m_den < 0) {
+        m_num = -m_num;
+        m_den = -m_den;
+    }
+
+    if(m_num == 0) {
+        m_den = 1;
+        return true;
+    }
+
+    qint64 g = gcd(m_num, m_den);
+    m_num /= g;
+    m_den /= g;
+    return true;
+}
+
+//*******************************************************************
+// addCommon
+//
+// a + bNum/bDen, where bNum/bDen is in lowest terms.
+//
+// Rather than bringing both over the full product of the denominators,
+// this divides out their gcd first. What's left over after the sum can
+// only share factors with that gcd, so the reduction at the end needs one
+// more small gcd. See Knuth, TAOCP vol. 2, 4.5.1.
+//
+// Where there is 128-bit arithmetic the sum is formed in it and reduced
+// before it's narrowed, so only an answer that won't fit fails. Without
+// it the sum is formed in 64 bits, and can fail when it overflows even
+// though the reduced answer would fit.
+//
+bool Fraction::addCommon(const Fraction& a, qint64 bNum, qint64 bDen,
+                         Fraction& result)
+{
+    qint64 num, den, g2;
+
+    if(!a.isValid() || bDen == 0) {
+        result.setInvalid();
+        return false;
+    }
+
+    qint64 g = gcd(a.m_den, bDen);
+    qint64 ad = a.m_den / g;
+    qint64 bd = bDen / g;
+
+#if defined(__SIZEOF_INT128__)
+    __int128 sum = (__int128)a.m_num * bd + (__int128)bNum * ad;
+
+    if(sum == 0) {
+        result = Fraction();
+        return true;
+    }
+
+    qint64 rem = (qint64)(sum % g);
+    g2 = (rem == 0) ? g : gcd(rem, g);
+    sum /= g2;
+
+    if(sum > LLONG_MAX || sum <= LLONG_MIN) {
+        result.setInvalid();
+        return false;
+    }
+    num = (qint64)sum;
+#else
+    qint64 t1, t2;
+
+    if(mulOverflow(a.m_num, bd, &t1) || mulOverflow(bNum, ad, &t2)
+    || addOverflow(t1, t2, &num) || num == LLONG_MIN) {
+        result.setInvalid();
+        return false;
+    }
+
+    if(num == 0) {
+        result = Fraction();
+        return true;
+    }
+
+    g2 = gcd(num, g);
+    num /= g2;
+#endif
+
+    if(mulOverflow(ad, bDen / g2, &den)) {
+        result.setInvalid();
+        return false;
+    }
+
+    result.m_num = num;
+    result.m_den = den;
+    return true;
+}
+
+//*******************************************************************
+bool Fraction::add(const Fraction& a, const Fraction& b, Fraction& result)
+{
+    return addCommon(a, b.m_num, b.m_den, result);
+}
+
+//*******************************************************************
+bool Fraction::sub(const Fraction& a, const Fraction& b, Fraction& result)
+{
+    return addCommon(a, -b.m_num, b.m_den, result);
+}
+
+//*******************************************************************
+// mul
+//
+// Cross-cancel before multiplying, so the products are already in
+// lowest terms and only overflow when the answer really is too big.
+//
+bool Fraction::mul(const Fraction& a, const Fraction& b, Fraction& result)
+{
+    qint64 num, den;
+
+    if(!a.isValid() || !b.isValid()) {
+        result.setInvalid();
+        return false;
+    }
+
+    if(a.m_num == 0 || b.m_num == 0) {
+        result = Fraction();
+        return true;
+    }
+
+    qint64 g1 = gcd(a.m_num, b.m_den);
+    qint64 g2 = gcd(b.m_num, a.m_den);
+
+    if(mulOverflow(a.m_num / g1, b.m_num / g2, &num) || num == LLONG_MIN
+    || mulOverflow(a.m_den / g2, b.m_den / g1, &den)) {
+        result.setInvalid();
+        return false;
+    }
+
+    result.m_num = num;
+    result.m_den = den;
+    return true;
+}
+
+//*******************************************************************
+bool Fraction::div(const Fraction& a, const Fraction& b, Fraction& result)
+{
+    if(!b.isValid() || b.m_num == 0) {
+        result.setInvalid();
+        return false;
+    }
+
+    Fraction recip;
+    recip.m_num = b.m_num < 0 ? -b.m_den : b.m_den;
+    recip.m_den = b.m_num < 0 ? -b.m_num : b.m_num;
+    return mul(a, recip, result);
+}
+
+//*******************************************************************
+// compare
+//
+// Compares a/b with c/d as a*d with c*b. Denominators are positive, so
+// the order is kept, and the signs of the numerators settle it unless
+// they match. Then the magnitudes of the products are compared in 128
+// bits, so no division is needed and nothing can overflow.
+//
+// Returns <0, 0 or >0 as a is less than, equal to or greater than b.
+// Invalid fractions sort after all valid ones.
+//
+int Fraction::compare(const Fraction& a, const Fraction& b)
+{
+    if(!a.isValid() || !b.isValid())
+        return (int)!a.isValid() - (int)!b.isValid();
+
+    if(a.m_den == b.m_den)
+        return (a.m_num > b.m_num) - (a.m_num < b.m_num);
+
+    int sa = (a.m_num > 0) - (a.m_num < 0);
+    int sb = (b.m_num > 0) - (b.m_num < 0);
+    if(sa != sb)
+        return sa - sb;
+
+    int c = compareProducts(absval(a.m_num), b.m_den,
+                            absval(b.m_num), a.m_den);
+    return sa < 0 ? -c : c;
+}
+
+//*******************************************************************
+char* Fraction::toChars(char* first, char* last) const
+{
+    char* p = nf::toChars(first, last, m_num);
+
+    if(p == 0 || m_den == 1)
+        return p;
+
+    if(p == last)
+        return 0;
+
+    *p++ = '/';
+    return nf::toChars(p, last, m_den);
+}
+
+/***********************
+** Batch Routines
+***********************/
+
+//*******************************************************************
+int Fraction::add(const Fraction* a, const Fraction* b, Fraction* result,
+                  int count)
+{
+    int failed = 0;
+
+    for(int i = 0; i < count; ++i)
+        failed += addCommon(a[i], b[i].m_num, b[i].m_den, result[i]) ? 0 : 1;
+
+    return failed;
+}
+
+//*******************************************************************
+int Fraction::sub(const Fraction* a, const Fraction* b, Fraction* result,
+                  int count)
+{
+    int failed = 0;
+
+    for(int i = 0; i < count; ++i)
+        failed += addCommon(a[i], -b[i].m_num, b[i].m_den, result[i]) ? 0 : 1;
+
+    return failed;
+}
+
+//*******************************************************************
+void Fraction::compare(const Fraction* a, const Fraction* b, int* result,
+                       int count)
+{
+    for(int i = 0; i < count; ++i)
+        result[i] = compare(a[i], b[i]);
+}
+
+//*******************************************************************
+// normalize
+//
+// For arrays read in raw, e.g. from a file, rather than built with the
+// constructor.
+//
+int Fraction::normalize(Fraction* f, int count)
+{
+    int failed = 0;
+
+    for(int i = 0; i < count; ++i)
+        failed += f[i].normalize() ? 0 : 1;
+
+    return failed;
+}
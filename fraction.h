@@ -0,0 +1,79 @@
+#ifndef FRACTION_H
+#define FRACTION_H
+
+#include <QtGlobal>
+
+//********************************************************************
+//
+// class Fraction
+//
+// A rational number with a 64-bit numerator and denominator, for the
+// fraction drills. It is a plain value type, and nothing here touches
+// the heap.
+//
+// A Fraction is always kept in lowest terms with a positive denominator,
+// so two equal fractions have equal members. A denominator of 0 marks the
+// result of dividing by zero or of an overflow. Such a fraction is not
+// valid, and any arithmetic on it fails.
+//
+// The arithmetic functions return false, and set the result invalid, when
+// the answer won't fit in 64 bits. On a compiler without 128-bit
+// integers, add() and sub() can also fail when their intermediate sum
+// overflows, though the answer would fit. The batch functions apply the
+// same operation across arrays and return the number of entries that
+// failed.
+//
+class Fraction
+{
+public:
+    Fraction() : m_num(0), m_den(1) {}
+    Fraction(qint64 num, qint64 den = 1) : m_num(num), m_den(den)
+        {normalize();}
+
+    qint64 numerator() const {return m_num;}
+    qint64 denominator() const {return m_den;}
+    bool isValid() const {return m_den != 0;}
+    bool isInteger() const {return m_den == 1;}
+
+    static bool add(const Fraction& a, const Fraction& b, Fraction& result);
+    static bool sub(const Fraction& a, const Fraction& b, Fraction& result);
+    static bool mul(const Fraction& a, const Fraction& b, Fraction& result);
+    static bool div(const Fraction& a, const Fraction& b, Fraction& result);
+    static int compare(const Fraction& a, const Fraction& b);
+
+    bool operator==(const Fraction& f) const
+        {return m_num == f.m_num && m_den == f.m_den;}
+    bool operator!=(const Fraction& f) const {return !(*this == f);}
+    bool operator<(const Fraction& f) const {return compare(*this, f) < 0;}
+    bool operator>(const Fraction& f) const {return compare(*this, f) > 0;}
+    bool operator<=(const Fraction& f) const {return compare(*this, f) <= 0;}
+    bool operator>=(const Fraction& f) const {return compare(*this, f) >= 0;}
+
+    // Writes "n/d", or just "n" when the denominator is 1, into
+    // [first, last). Returns one past the last char written, or 0 if it
+    // didn't fit. MaxChars is always enough.
+    //
+    enum { MaxChars = 41 };
+    char* toChars(char* first, char* last) const;
+
+    // Batch operations
+    //
+    static int add(const Fraction* a, const Fraction* b, Fraction* result,
+                   int count);
+    static int sub(const Fraction* a, const Fraction* b, Fraction* result,
+                   int count);
+    static void compare(const Fraction* a, const Fraction* b, int* result,
+                        int count);
+    static int normalize(Fraction* f, int count);
+
+private:
+    qint64 m_num;       // Numerator, carries the sign
+    qint64 m_den;       // Denominator, > 0, or 0 when invalid
+
+    bool normalize();
+    void setInvalid() {m_num = 0; m_den = 0;}
+    static bool addCommon(const Fraction& a, qint64 bNum, qint64 bDen,
+                          Fraction& result);
+};
+
+#endif // FRACTION_H
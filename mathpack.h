@@ -35,6 +35,7 @@
 #include "resultfilemanager.h"
 #include "leastcommult.h"
 #include "factors.h"
+#include "fraction.h"
 
 class MATHPACKSHARED_EXPORT Mathpack {
 public:
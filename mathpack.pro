@@ -13,18 +13,42 @@ DEPENDPATH += ../lib
 win32:CONFIG(debug, debug|release): LIBS += -L../../lib -lqpgui
 else:unix: LIBS += -L../../lib -lqpgui
 
-CONFIG += staticlib
+CONFIG += staticlib c++17
 
 DEFINES += MATHPACK_LIBRARY
 
+# compressedlog.cpp calls zlib itself, the copy bundled with Qt unless Qt
+# was built to use the system's.
+#
+qtConfig(system-zlib): LIBS += -lz
+else: QT_PRIVATE += zlib-private
+
 SOURCES += \
     randomop.cpp \
     mersenne.cpp \
     mpscore.cpp \
     testparm.cpp \
     resultfilemanager.cpp \
+    resultsink.cpp \
+    rowformatter.cpp \
+    resultcolumns.cpp \
+    resultindex.cpp \
+    resultshards.cpp \
+    compressedlog.cpp \
+    problemgen.cpp \
+    answerkey.cpp \
+    exprgen.cpp \
     leastcommult.cpp \
     factors.cpp \
+    factors64.cpp \
+    fraction.cpp \
+    fastdiv.cpp \
+    teststats.cpp \
+    testdef.cpp \
+    testsession.cpp \
+    testplan.cpp \
+    timerwheel.cpp \
+    eventlog.cpp \
     randmanager.cpp \
     testparmmanager.cpp
 
@@ -37,8 +61,27 @@ HEADERS += \
     testparm.h \
     resultfile.h \
     resultfilemanager.h \
+    resultsink.h \
+    rowformatter.h \
+    resultcolumns.h \
+    resultindex.h \
+    resultshards.h \
+    compressedlog.h \
+    problemgen.h \
+    answerkey.h \
+    exprgen.h \
     leastcommult.h \
     factors.h \
+    numtheory.h \
+    numformat.h \
+    fraction.h \
+    fastdiv.h \
+    teststats.h \
+    testdef.h \
+    testsession.h \
+    testplan.h \
+    timerwheel.h \
+    eventlog.h \
     randmanager.h \
     testparmmanager.h
 
@@ -26,6 +26,24 @@
 
 #include "mpscore.h"
 
+// The grading scale MpScore has always used.
+//
+static constexpr GradeStep standardSteps[] = {
+    {98, "A+"}, {93, "A"}, {90, "A-"},
+    {88, "B+"}, {83, "B"}, {80, "B-"},
+    {78, "C+"}, {73, "C"}, {70, "C-"},
+    {68, "D+"}, {63, "D"}, {60, "D-"},
+    { 0, "F"}
+};
+
+static constexpr GradeScale standardScale(
+        standardSteps, sizeof(standardSteps) / sizeof(standardSteps[0]));
+
+const GradeScale& GradeScale::standard()
+{
+    return standardScale;
+}
+
 int MpScore::getPercentGrade()
 {
     return getPercentGradeCommon();
@@ -60,20 +78,37 @@ const char *MpScore::getLetterGrade(int count, int correct)
 const char *MpScore::getLetterGradeCommon()
 {
     getPercentGrade();
+    m_letterGrade = m_scale->gradeName(m_scale->gradeCode(m_percent));
+    return m_letterGrade;
+}
 
-    if (m_percent >= 98) m_letterGrade = "A+";
-    else if (m_percent >= 93 && m_percent < 98) m_letterGrade = "A";
-    else if (m_percent >= 90 && m_percent < 93) m_letterGrade = "A-";
-    else if (m_percent >= 88 && m_percent < 90) m_letterGrade = "B+";
-    else if (m_percent >= 83 && m_percent < 88) m_letterGrade = "B";
-    else if (m_percent >= 80 && m_percent < 83) m_letterGrade = "B-";
-    else if (m_percent >= 78 && m_percent < 80) m_letterGrade = "C+";
-    else if (m_percent >= 73 && m_percent < 78) m_letterGrade = "C";
-    else if (m_percent >= 70 && m_percent < 73) m_letterGrade = "C-";
-    else if (m_percent >= 68 && m_percent < 70) m_letterGrade = "D+";
-    else if (m_percent >= 63 && m_percent < 68) m_letterGrade = "D";
-    else if (m_percent >= 60 && m_percent < 63) m_letterGrade = "D-";
-    else m_letterGrade = "F";
+//////////////////////////////////////////////////////////////////////////////
+//
+// grade - grade a whole column of scores in one pass
+//
+// counts   - number of problems in each test
+// corrects - number answered correctly in each test
+// size     - number of tests
+// percents - receives each percent score, clamped to 0..100
+// grades   - receives each grade code, see GradeScale::gradeName()
+// scale    - the grading scale to use
+//
+// The percent is worked out in double precision. correct * 100 / count
+// is never within 1 / (100 * count) of an integer unless it is one, far
+// more than a double's rounding error, so truncating it gives the same
+// answer as integer division. Unlike integer division, it vectorizes.
+//
+void MpScore::grade(const int *counts, const int *corrects, int size,
+                    unsigned char *percents, unsigned char *grades,
+                    const GradeScale& scale)
+{
+    for(int i = 0; i < size; ++i) {
+        double count = counts[i] > 0 ? counts[i] : 1;
+        double pct = counts[i] > 0 ? corrects[i] * 100.0 / count : 0.0;
+        pct = pct < 0.0 ? 0.0 : (pct > 100.0 ? 100.0 : pct);
+        percents[i] = (unsigned char)pct;
+    }
 
-    return m_letterGrade;
+    for(int i = 0; i < size; ++i)
+        grades[i] = scale.gradeCode(percents[i]);
 }
@@ -27,17 +27,105 @@
 #ifndef MPSCORE_H
 #define MPSCORE_H
 
+//********************************************************************
+//
+// struct GradeStep
+//
+// One letter grade in a grading scale, with the lowest percent that
+// earns it.
+//
+struct GradeStep {
+    int minPercent;
+    const char *name;
+};
+
+//********************************************************************
+//
+// class GradeScale
+//
+// Maps a percent score straight to a letter grade through a table of
+// 101 entries, one for each percent from 0 to 100. Grades are identified
+// by a small code, their position in the list of steps the scale was
+// built from, with 0 being the best grade.
+//
+// Steps must be given best first, in strictly descending order of
+// minPercent. Percents below the last step's minPercent get the last
+// grade, as do percents below 0. Percents over 100 get the first.
+//
+// A scale can be built at compile time, as the standard one is, e.g.
+//
+//  static constexpr GradeStep steps[] = {{90,"A"}, {80,"B"}, {0,"F"}};
+//  static constexpr GradeScale scale(steps, 3);
+//
+// or loaded at run time, e.g. from a school's settings, with load().
+//
+class GradeScale {
+public:
+    enum { TableSize = 101, MaxGrades = 16 };
+
+    constexpr GradeScale() : m_table{}, m_names{}, m_count(0) {}
+    constexpr GradeScale(const GradeStep *steps, int count)
+        : m_table{}, m_names{}, m_count(0) {load(steps, count);}
+
+    constexpr bool load(const GradeStep *steps, int count)
+    {
+        if(count < 1 || count > MaxGrades)
+            return false;
+
+        for(int i = 1; i < count; ++i)
+            if(steps[i].minPercent >= steps[i - 1].minPercent)
+                return false;
+
+        int code = count - 1;
+        for(int pct = 0; pct < TableSize; ++pct) {
+            while(code > 0 && pct >= steps[code - 1].minPercent)
+                --code;
+            m_table[pct] = (unsigned char)code;
+        }
+
+        for(int i = 0; i < count; ++i)
+            m_names[i] = steps[i].name;
+
+        m_count = count;
+        return true;
+    }
+
+    int gradeCount() const {return m_count;}
+    const char *gradeName(int code) const {return m_names[code];}
+    unsigned char gradeCode(int percent) const
+    {
+        percent = percent < 0 ? 0 : (percent > 100 ? 100 : percent);
+        return m_table[percent];
+    }
+
+    static const GradeScale& standard();
+
+private:
+    unsigned char m_table[TableSize];   // Grade code for each percent
+    const char *m_names[MaxGrades];     // Letter for each grade code
+    int m_count;                        // Number of grades in the scale
+};
+
 class MpScore {
 public:
-    MpScore() {m_count=0; m_correct=0; m_percent=0;}
-    MpScore(int count, int correct) {m_count = count; m_correct = correct;}
+    MpScore() {m_count=0; m_correct=0; m_percent=0;
+               m_scale = &GradeScale::standard();}
+    MpScore(int count, int correct) {m_count = count; m_correct = correct;
+               m_percent = 0; m_scale = &GradeScale::standard();}
     void setCount(int count) {m_count = count;}
     void setCorrect(int correct) {m_correct = correct;}
+    void setScale(const GradeScale *scale) {m_scale = scale;}
     int getPercentGrade();
     int getPercentGrade(int count, int correct);
     const char *getLetterGrade();
     const char *getLetterGrade(int count, int correct);
 
+    // Batch grading over columns of scores.
+    //
+    static void grade(const int *counts, const int *corrects, int size,
+                      unsigned char *percents, unsigned char *grades,
+                      const GradeScale& scale = GradeScale::standard());
+
 
 private:
     int m_count;                // Total number of problems
@@ -46,6 +134,7 @@ private:
     int getPercentGradeCommon();
     const char *m_letterGrade;  // Letter Grade
     const char *getLetterGradeCommon();
+    const GradeScale *m_scale;  // Grading scale for letter grades
 };
 
 #endif // MPSCORE_H
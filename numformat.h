@@ -0,0 +1,166 @@
+#ifndef NUMFORMAT_H
+#define NUMFORMAT_H
+
+#include <QtGlobal>
+
+//********************************************************************
+//
+// namespace nf
+//
+// Integer to text conversion into caller buffers, in the manner of
+// std::to_chars. Nothing here allocates.
+//
+// toChars(first, last, v)  - writes v in decimal into [first, last).
+//                            Returns one past the last char written, or
+//                            0 if it didn't fit.
+// digits(v)                - number of chars toChars will write for v,
+//                            counting the minus sign
+//
+// Text to number conversion the other way, in the manner of
+// std::from_chars, over char or UTF-16 buffers. Pass a QString's text as
+// (const ushort*)s.utf16(). Unlike std::from_chars, a leading '+' is
+// taken.
+//
+// fromChars(first, last, v)  - reads a decimal integer at first.
+//                              Returns one past the last char read, or
+//                              0 if there are no digits or v would
+//                              overflow.
+// fromChars(first, last, m, e) - reads a decimal number with an optional
+//                              point and exponent, e.g. "-0.50" or
+//                              "1.5e3", as m * 10^e. Significant digits
+//                              past the 18th are dropped. Returns as
+//                              above.
+//
+namespace nf
+{
+    inline int digits(quint64 v)
+    {
+        int n = 1;
+        for(; v >= 10000; v /= 10000)
+            n += 4;
+        if(v >= 1000) return n + 3;
+        if(v >= 100) return n + 2;
+        if(v >= 10) return n + 1;
+        return n;
+    }
+
+    inline int digits(qint64 v)
+    {
+        return v < 0 ? 1 + digits(0 - (quint64)v) : digits((quint64)v);
+    }
+
+    inline char* toChars(char* first, char* last, quint64 v)
+    {
+        int n = digits(v);
+        if(last - first < n)
+            return 0;
+
+        char* p = first + n;
+        do {
+            *--p = char('0' + v % 10);
+            v /= 10;
+        } while(v != 0);
+        return first + n;
+    }
+
+    inline char* toChars(char* first, char* last, qint64 v)
+    {
+        if(v >= 0)
+            return toChars(first, last, (quint64)v);
+
+        if(last - first < 2)
+            return 0;
+        *first = '-';
+        return toChars(first + 1, last, 0 - (quint64)v);
+    }
+
+    inline char* toChars(char* first, char* last, int v)
+        {return toChars(first, last, (qint64)v);}
+
+    template<class C>
+    inline bool isDigit(C c) {return c >= C('0') && c <= C('9');}
+
+    template<class C>
+    inline const C* fromChars(const C* first, const C* last, qint64& v)
+    {
+        const C* p = first;
+        bool neg = false;
+
+        if(p < last && (*p == C('-') || *p == C('+')))
+            neg = *p++ == C('-');
+
+        quint64 limit = neg ? quint64(1) << 63 : (quint64(1) << 63) - 1;
+        quint64 u = 0;
+        const C* digits = p;
+
+        for(; p < last && isDigit(*p); ++p) {
+            uint d = uint(*p - C('0'));
+            if(u > (limit - d) / 10)
+                return 0;
+            u = u * 10 + d;
+        }
+        if(p == digits)
+            return 0;
+
+        v = neg ? qint64(0 - u) : qint64(u);
+        return p;
+    }
+
+    template<class C>
+    inline const C* fromChars(const C* first, const C* last,
+                              qint64& mant, int& exp10)
+    {
+        const C* p = first;
+        bool neg = false;
+
+        if(p < last && (*p == C('-') || *p == C('+')))
+            neg = *p++ == C('-');
+
+        quint64 u = 0;
+        int exp = 0;
+        int sig = 0;
+        int count = 0;
+        bool point = false;
+
+        for(; p < last; ++p) {
+            if(*p == C('.') && !point) {
+                point = true;
+                continue;
+            }
+            if(!isDigit(*p))
+                break;
+
+            ++count;
+            uint d = uint(*p - C('0'));
+
+            if(sig < 18) {
+                u = u * 10 + d;
+                sig += (u != 0);
+                exp -= point;
+            } else {
+                exp += !point;
+            }
+        }
+        if(count == 0)
+            return 0;
+
+        // An exponent is only taken if it has digits.
+        //
+        if(p < last && (*p == C('e') || *p == C('E'))) {
+            qint64 e;
+            const C* q = fromChars(p + 1, last, e);
+            if(q) {
+                if(e < -9999 || e > 9999)
+                    return 0;
+                exp += int(e);
+                p = q;
+            }
+        }
+
+        mant = neg ? -qint64(u) : qint64(u);
+        exp10 = exp;
+        return p;
+    }
+}
+
+#endif // NUMFORMAT_H
@@ -0,0 +1,182 @@
+#ifndef NUMTHEORY_H
+#define NUMTHEORY_H
+
+#include <array>
+
+//********************************************************************
+//
+// namespace nt
+//
+// Compile-time number theory. Many drill levels have fixed bounds, e.g.
+// factors of numbers up to 144 or the LCM of numbers up to 20. Building
+// the answers for those with the templates below bakes them into the
+// binary as tables, so checking an answer is a lookup.
+//
+// Everything here is constexpr and header-only. It needs C++17.
+//
+// gcd(a, b)            - greatest common divisor, gcd(0, 0) is 0
+// lcm(a, b)            - least common multiple, 0 if either is 0
+// lcmRange<N>()        - LCM of 1 through N
+// primeCount<N>()      - number of primes <= N
+// primeTable<N>()      - std::array of the primes <= N, ascending
+// DivisorTable<N>      - every divisor of every n <= N, ascending,
+//                        including 1 and n itself
+// divisorTable<N>      - a DivisorTable<N> built at compile time
+//
+namespace nt
+{
+    template<typename T>
+    constexpr T gcd(T a, T b)
+    {
+        if(a < 0) a = -a;
+        if(b < 0) b = -b;
+
+        while(b != 0) {
+            T r = a % b;
+            a = b;
+            b = r;
+        }
+        return a;
+    }
+
+    template<typename T>
+    constexpr T lcm(T a, T b)
+    {
+        if(a == 0 || b == 0)
+            return 0;
+
+        T l = a / gcd(a, b) * b;
+        return l < 0 ? -l : l;
+    }
+
+    template<int N>
+    constexpr unsigned long long lcmRange()
+    {
+        static_assert(N >= 1 && N <= 46,
+                      "LCM of 1..N overflows 64 bits past N=46");
+        unsigned long long l = 1;
+        for(int i = 2; i <= N; ++i)
+            l = lcm<unsigned long long>(l, i);
+        return l;
+    }
+
+    // Sieve of Eratosthenes. Entry n is true when n is prime.
+    //
+    template<int N>
+    constexpr std::array<bool, N + 1> sieve()
+    {
+        std::array<bool, N + 1> prime{};
+
+        for(int i = 2; i <= N; ++i)
+            prime[i] = true;
+
+        for(int i = 2; i <= N / i; ++i) {
+            if(!prime[i])
+                continue;
+            for(int j = i * i; j <= N; j += i)
+                prime[j] = false;
+        }
+        return prime;
+    }
+
+    template<int N>
+    constexpr int primeCount()
+    {
+        std::array<bool, N + 1> prime = sieve<N>();
+        int count = 0;
+
+        for(int i = 2; i <= N; ++i)
+            count += prime[i] ? 1 : 0;
+        return count;
+    }
+
+    template<int N>
+    constexpr std::array<int, primeCount<N>()> primeTable()
+    {
+        std::array<bool, N + 1> prime = sieve<N>();
+        std::array<int, primeCount<N>()> table{};
+        int count = 0;
+
+        for(int i = 2; i <= N; ++i)
+            if(prime[i])
+                table[count++] = i;
+        return table;
+    }
+
+    // Total number of divisors of all the numbers 1 through N.
+    //
+    template<int N>
+    constexpr int divisorTotal()
+    {
+        int total = 0;
+        for(int d = 1; d <= N; ++d)
+            total += N / d;
+        return total;
+    }
+
+    //****************************************************************
+    //
+    // class DivisorTable
+    //
+    // The divisors of n are at divisors[offsets[n]] up to, but not
+    // including, divisors[offsets[n + 1]]. Filling in by divisor rather
+    // than by n leaves each list in ascending order.
+    //
+    template<int N>
+    class DivisorTable
+    {
+    public:
+        enum { Max = N, Total = divisorTotal<N>() };
+
+        constexpr DivisorTable() : m_offsets{}, m_divisors{}
+        {
+            std::array<int, N + 1> fill{};
+
+            for(int n = 1; n <= N; ++n)
+                for(int d = 1; d <= n / d; ++d)
+                    if(n % d == 0)
+                        m_offsets[n + 1] += (d * d == n) ? 1 : 2;
+
+            for(int n = 1; n <= N; ++n) {
+                m_offsets[n + 1] += m_offsets[n];
+                fill[n] = m_offsets[n];
+            }
+
+            for(int d = 1; d <= N; ++d)
+                for(int n = d; n <= N; n += d)
+                    m_divisors[fill[n]++] = d;
+        }
+
+        // These assume 1 <= n <= N.
+        //
+        constexpr int count(int n) const
+            {return m_offsets[n + 1] - m_offsets[n];}
+        constexpr const int* divisors(int n) const
+            {return &m_divisors[m_offsets[n]];}
+        constexpr int divisor(int n, int i) const
+            {return m_divisors[m_offsets[n] + i];}
+        constexpr bool isPrime(int n) const
+            {return count(n) == 2;}
+
+    private:
+        std::array<int, N + 2> m_offsets;
+        std::array<int, Total> m_divisors;
+    };
+
+    template<int N>
+    inline constexpr DivisorTable<N> divisorTable{};
+
+    // Upper bound of the factor table that class Factors looks up before
+    // it falls back to trial division.
+    //
+    constexpr int FactorTableMax = 144;
+
+    static_assert(gcd(84, 36) == 12, "gcd");
+    static_assert(lcm(4, 6) == 12, "lcm");
+    static_assert(lcmRange<20>() == 232792560ULL, "lcmRange");
+    static_assert(primeTable<30>()[9] == 29, "primeTable");
+    static_assert(divisorTable<12>.count(12) == 6, "DivisorTable");
+    static_assert(divisorTable<12>.divisor(12, 4) == 6, "DivisorTable");
+}
+
+#endif // NUMTHEORY_H
@@ -0,0 +1,283 @@
+#include <QtCore>
+#include <cmath>
+
+#include <problemgen.h>
+
+/****************************
+** ProblemGenerator Routines
+****************************/
+
+//*******************************************************************
+// generate
+//
+// Append a batch of problems, with their answers, to out.
+//
+// tp    - the test to take terms and limits from, at its current level
+// op    - the operation of every problem in the batch
+// count - the number of problems to make
+// out   - the array the records are appended to
+//
+// Returns the number of problems made, 0 if tp has no limits for its
+// level.
+//
+int ProblemGenerator::generate(TestParm& tp, tp::oper_t op, int count,
+                               QVector<ProblemRecord>& out)
+{
+    int lvl = tp.level;
+
+    if(count <= 0 || lvl < 0 || lvl >= tp.maxterms.size()
+    || lvl >= tp.minvals.size() || lvl >= tp.maxvals.size()
+    || tp.minvals[lvl].isEmpty() || tp.maxvals[lvl].isEmpty())
+        return 0;
+
+    const QVector<int>& mins = tp.minvals[lvl];
+    const QVector<int>& maxs = tp.maxvals[lvl];
+    bool constructed = (op == tp::op_div || op == tp::op_mod
+                     || op == tp::op_sqr || op == tp::op_sqrt);
+
+    // RandOp only takes its limits once, so it's cleared whenever the
+    // operation or the limits change.
+    //
+    if(constructed) {
+        quint64 key = RandManager::configKey(op, 0, mins, maxs);
+
+        if(key != m_opKey) {
+            int r = qMin(1, qMin(mins.size(), maxs.size()) - 1);
+            m_randop.clear();
+            m_randop.setMinMax(mins[0], maxs[0], mins[r], maxs[r]);
+            m_opKey = key;
+        }
+    } else {
+        tp.randman.update(tp.maxterms[lvl], tp.count, tp.minvals[lvl],
+                          tp.maxvals[lvl]);
+    }
+
+    int first = out.size();
+    out.resize(first + count);
+    ProblemRecord* recs = out.data() + first;
+
+    for(int i = 0; i < count; ++i) {
+        ProblemRecord& rec = recs[i];
+        QPoint ops;
+
+        memset(&rec, 0, sizeof(rec));
+        rec.oper = (quint8)op;
+
+        switch(op) {
+        case tp::op_div:
+            m_randop.getDivPair(ops);
+            break;
+        case tp::op_mod:
+            m_randop.getModPair(ops);
+            break;
+        case tp::op_sqr:
+            m_randop.getSqrPair(ops);
+            break;
+        case tp::op_sqrt:
+            m_randop.getSqrtPair(ops);
+            break;
+        default:
+            tp.randman.getValues(m_vals);
+            break;
+        }
+
+        if(constructed) {
+            rec.terms[0] = ops.x();
+            rec.terms[1] = ops.y();
+            rec.termCount = (op == tp::op_div || op == tp::op_mod) ? 2 : 1;
+        } else {
+            int n = qMin(m_vals.size(), (int)ProblemRecord::MaxTerms);
+            for(int j = 0; j < n; ++j)
+                rec.terms[j] = m_vals[j];
+            rec.termCount = (quint8)n;
+        }
+    }
+
+    computeAnswers(recs, count);
+    return count;
+}
+
+//*******************************************************************
+// computeAnswers
+//
+// Work out the answer of every record, and set its flags.
+//
+// The records are taken in runs of the same operation and term count,
+// which a batch from generate() is. Each run is worked out a term at a
+// time over the whole run, in loops that do one thing to every record
+// and don't branch on the operation. Sums and products are kept in 64
+// bits, and anything that won't fit back in an int is flagged as it
+// goes. A product is cut back to 32 bits after each term, so it can't
+// overflow the 64 bits either.
+//
+void ProblemGenerator::computeAnswers(ProblemRecord* recs, int count)
+{
+    QVector<qint64> acc;
+    QVector<quint8> flags;
+
+    for(int start = 0; start < count;) {
+        int op = recs[start].oper;
+        int terms = recs[start].termCount;
+        int end = start + 1;
+
+        while(end < count && recs[end].oper == op
+           && recs[end].termCount == terms)
+            ++end;
+
+        int n = end - start;
+        ProblemRecord* run = recs + start;
+
+        acc.resize(n);
+        flags.fill(0, n);
+        qint64* a = acc.data();
+        quint8* f = flags.data();
+
+        for(int i = 0; i < n; ++i)
+            a[i] = terms > 0 ? run[i].terms[0] : 0;
+
+        switch(op) {
+        case tp::op_add:
+            for(int t = 1; t < terms; ++t)
+                for(int i = 0; i < n; ++i)
+                    a[i] += run[i].terms[t];
+            for(int i = 0; i < n; ++i)
+                f[i] = (a[i] != (qint32)a[i]) ? ProblemRecord::Overflow : 0;
+            break;
+
+        case tp::op_sub:
+            for(int t = 1; t < terms; ++t)
+                for(int i = 0; i < n; ++i)
+                    a[i] -= run[i].terms[t];
+            for(int i = 0; i < n; ++i)
+                f[i] = (a[i] != (qint32)a[i]) ? ProblemRecord::Overflow : 0;
+            break;
+
+        case tp::op_mul:
+        case tp::op_sqr:
+            for(int t = (op == tp::op_sqr) ? 0 : 1; t < terms; ++t) {
+                for(int i = 0; i < n; ++i) {
+                    a[i] *= run[i].terms[t];
+                    f[i] |= (a[i] != (qint32)a[i])
+                          ? ProblemRecord::Overflow : 0;
+                    a[i] = (qint32)a[i];
+                }
+            }
+            break;
+
+        case tp::op_div:
+        case tp::op_mod:
+            if(terms < 2) {
+                flags.fill(ProblemRecord::Undefined);
+                break;
+            }
+            for(int i = 0; i < n; ++i) {
+                qint64 d = run[i].terms[1];
+                f[i] = (d == 0) ? ProblemRecord::Undefined : 0;
+                d += (d == 0);
+                a[i] = (op == tp::op_div) ? a[i] / d : a[i] % d;
+                f[i] |= (a[i] != (qint32)a[i]) ? ProblemRecord::Overflow : 0;
+            }
+            break;
+
+        case tp::op_sqrt:
+            for(int i = 0; i < n; ++i) {
+                qint64 x = a[i];
+                qint64 r = x > 0 ? (qint64)std::sqrt((double)x) : 0;
+                r -= (r * r > x);
+                f[i] = (x < 0 || r * r != x) ? ProblemRecord::Undefined : 0;
+                a[i] = r;
+            }
+            break;
+
+        default:
+            flags.fill(ProblemRecord::Undefined);
+            break;
+        }
+
+        for(int i = 0; i < n; ++i) {
+            run[i].flags = f[i];
+            run[i].answer = f[i] ? 0 : (qint32)a[i];
+        }
+
+        start = end;
+    }
+}
+
+//*******************************************************************
+// render
+//
+// Write the text of a problem into out, e.g. "12 ÷ 4" or "√81". out is
+// cleared first and keeps its capacity, so rendering one problem after
+// another into the same string soon stops allocating.
+//
+// Returns out.
+//
+QString& ProblemGenerator::render(const ProblemRecord& rec, QString& out)
+{
+    static const ushort signs[] = {'+', '-', 0x00d7, 0x00f7};
+
+    out.resize(0);
+
+    if(rec.termCount == 0)
+        return out;
+
+    switch(rec.oper) {
+    case tp::op_sqr:
+        if(rec.terms[0] < 0)
+            out.append(QChar('(')).append(QString::number(rec.terms[0]))
+               .append(QChar(')'));
+        else
+            out.append(QString::number(rec.terms[0]));
+        out.append(QChar(0x00b2));
+        break;
+
+    case tp::op_sqrt:
+        out.append(QChar(0x221a)).append(QString::number(rec.terms[0]));
+        break;
+
+    default:
+        out.append(QString::number(rec.terms[0]));
+
+        for(int i = 1; i < rec.termCount; ++i) {
+            if(rec.oper == tp::op_mod)
+                out.append(QLatin1String(" mod "));
+            else if(rec.oper < 4) {
+                out.append(QChar(' ')).append(QChar(signs[rec.oper]))
+                   .append(QChar(' '));
+            }
+            out.append(QString::number(rec.terms[i]));
+        }
+        break;
+    }
+    return out;
+}
+
+//*******************************************************************
+// renderAnswer
+//
+// Write the answer of a problem into out. A flagged answer is left
+// empty.
+//
+// Returns out.
+//
+QString& ProblemGenerator::renderAnswer(const ProblemRecord& rec,
+                                        QString& out)
+{
+    out.resize(0);
+
+    if(rec.flags == 0)
+        out.append(QString::number(rec.answer));
+    return out;
+}
+
+//*******************************************************************
+// apply
+//
+// Set a TestParm's problem and correctAnswer strings from a record,
+// when it is about to be shown.
+//
+void ProblemGenerator::apply(const ProblemRecord& rec, TestParm& tp)
+{
+    render(rec, tp.problem);
+    renderAnswer(rec, tp.correctAnswer);
+}
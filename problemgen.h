@@ -0,0 +1,82 @@
+#ifndef PROBLEMGEN_H
+#define PROBLEMGEN_H
+
+#include <QVector>
+#include <randomop.h>
+#include <testparm.h>
+
+QT_BEGIN_NAMESPACE
+class QString;
+QT_END_NAMESPACE
+
+//********************************************************************
+//
+// struct ProblemRecord
+//
+// One problem and its answer, packed into 32 bytes with no pointers, so
+// a batch of them is one flat array.
+//
+// oper      - the operation, a tp::oper_t
+// termCount - number of terms used
+// flags     - Overflow if the answer doesn't fit in an int, Undefined if
+//             it doesn't exist, e.g. a division by zero
+// answer    - the correct answer, 0 if any flag is set
+// terms     - the terms of the problem. Division and remainder problems
+//             are dividend then divisor, and square and square root
+//             problems have just the one term.
+//
+struct ProblemRecord
+{
+    enum {MaxTerms = 6};
+    enum {Overflow = 0x01, Undefined = 0x02};
+
+    quint8 oper;
+    quint8 termCount;
+    quint8 flags;
+    quint8 reserved;
+    qint32 answer;
+    qint32 terms[MaxTerms];
+};
+
+static_assert(sizeof(ProblemRecord) == 32, "ProblemRecord layout changed");
+
+//********************************************************************
+//
+// class ProblemGenerator
+//
+// Makes problems and their answers for any tp::oper_t a batch at a time,
+// using the terms and limits of a TestParm at its current level.
+//
+// Sums, differences and products take their terms from the TestParm's
+// RandManager, as TestPlan does. Division, remainder, square and square
+// root problems are built by RandOp's constructive generators, so they
+// always come out even. Their first term's limits bound the quotient or
+// the root, and the second term's limits bound the divisor.
+//
+// The answers are worked out afterwards, one operation over the whole
+// batch at a time, in 64 bits, and flagged if they don't fit in an int.
+//
+// Nothing is turned into text while generating. render() and
+// renderAnswer() do that for one problem when it is shown, and apply()
+// fills in a TestParm's problem and correctAnswer strings.
+//
+class ProblemGenerator
+{
+public:
+    ProblemGenerator() {m_opKey = 0;}
+
+    int generate(TestParm& tp, tp::oper_t op, int count,
+                 QVector<ProblemRecord>& out);
+
+    static void computeAnswers(ProblemRecord* recs, int count);
+    static QString& render(const ProblemRecord& rec, QString& out);
+    static QString& renderAnswer(const ProblemRecord& rec, QString& out);
+    static void apply(const ProblemRecord& rec, TestParm& tp);
+
+private:
+    RandOp m_randop;            // For the constructed problems
+    quint64 m_opKey;            // Operation and limits m_randop is set for
+    QVector<int> m_vals;        // Terms from the RandManager
+};
+
+#endif // PROBLEMGEN_H
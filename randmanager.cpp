@@ -20,6 +20,18 @@
  ** PUBLIC ROUTINES
  *********************************/
 
+// One FNV-1a step per byte of value, for configKey().
+//
+static void mixKey(quint64& key, int value)
+{
+    quint32 v = (quint32)value;
+
+    for(int i = 0; i < 4; ++i, v >>= 8) {
+        key ^= v & 0xff;
+        key *= 1099511628211ULL;
+    }
+}
+
 //////////////////////////////////////////////////////////////////////////////
 //
 // RandManager constructor
@@ -32,6 +44,10 @@
 RandManager::
 RandManager(int terms, int probs, QVector<int> &mins, QVector<int> &maxs)
 {
+    m_inited = false;
+    m_configKey = 0;
+    m_seed = 0;
+    m_seeded = false;
     init(terms, probs, mins, maxs);
 }
 
@@ -78,9 +94,16 @@ RandManager::init(int terms, int probs, QVector<int> &mins, QVector<int> &maxs)
             m_maxList << maxs[i];
     }
 
-    // Initialize the random number generator.
+    // Initialize the random number generator. A seed from setSeed() is
+    // mixed with the configuration, so each test of a seeded session
+    // gets a stream of its own and the same seed always repeats it.
     //
+    m_configKey = configKey(terms, probs, mins, maxs);
+
     int seed = (int)time(0);
+    if(m_seeded)
+        seed = (int)(m_seed ^ (quint32)m_configKey
+                            ^ (quint32)(m_configKey >> 32));
     m_rnd.RandomInit(seed);
 
     m_small = MAX_SMALLNUM;
@@ -88,6 +111,59 @@ RandManager::init(int terms, int probs, QVector<int> &mins, QVector<int> &maxs)
     m_smallcount = 0;
     m_sames = 1;
     m_nozero = false;
+
+    m_inited = true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// update - initializes the RandManager only if its configuration changed
+//
+// init() reseeds the generator, which costs hundreds of steps, and
+// forgets every value presented so far, which lets stale problems repeat.
+// Callers that set up the RandManager before every problem should call
+// this instead. It compares a hash of the arguments with that of the
+// last init(), so it costs a pass over the min and max lists.
+//
+// Arguments are the same as for init().
+//
+// Returns true if the RandManager was initialized.
+//
+bool
+RandManager::update(int terms, int probs,
+                    QVector<int> &mins, QVector<int> &maxs)
+{
+    if(m_inited && configKey(terms, probs, mins, maxs) == m_configKey)
+        return false;
+
+    init(terms, probs, mins, maxs);
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// configKey - hash of an init() configuration
+//
+// 64-bit FNV-1a over the term and problem counts and the limit lists,
+// with the list sizes mixed in so that lists of different lengths don't
+// hash alike.
+//
+quint64 RandManager::configKey(int terms, int probs,
+                               const QVector<int>& mins,
+                               const QVector<int>& maxs)
+{
+    quint64 key = 14695981039346656037ULL;
+
+    mixKey(key, terms);
+    mixKey(key, probs);
+    mixKey(key, mins.size());
+    for(int i = 0; i < mins.size(); ++i)
+        mixKey(key, mins[i]);
+    mixKey(key, maxs.size());
+    for(int i = 0; i < maxs.size(); ++i)
+        mixKey(key, maxs[i]);
+
+    return key;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -160,8 +236,15 @@ QVector<int>& RandManager::getValues(QVector<int>& vals)
 //
 QVector<int>& RandManager::getValues(QVector<int>& vals, int terms)
 {
+    int tries = 0;              // Values rejected since the last reset
+    bool reset = false;         // History has been cleared for this call
+    bool relax = false;         // Take any value in range
+
     vals.clear();   // clear the vals list
 
+    if(terms > m_dimension)
+        terms = m_dimension;
+
 #ifdef RANDMAN_DEBUG
     qDebug() << "RandManager::getValues()" << endl;
     int count = 0;
@@ -180,28 +263,61 @@ QVector<int>& RandManager::getValues(QVector<int>& vals, int terms)
             }
         }
 #endif
-        bool small = (abs(k) < m_smallest);
-        if(k < m_smallest)
-            continue;
+        // If too many values have been rejected, the unused values have
+        // run out. Forget the problems presented so far and try again,
+        // and if that fails too, take the values as they come rather
+        // than loop forever.
+        //
+        if(tries >= RETRY_LIMIT) {
+            if(!reset) {
+                for(int i = 0; i < m_vals.size(); ++i)
+                    m_vals[i].clear();
+                m_smallcount = 0;
+                reset = true;
+                tries = 0;
+            } else {
+                relax = true;
+            }
+        }
 
-        if(k == 0 && m_nozero)
-            continue;
+        if(!relax) {
+            bool small = (abs(k) < m_smallest);
+            if(k < m_smallest) {
+                ++tries;
+                continue;
+            }
 
-        m_smallcount += small ? 1 : 0;
-        if(small && (m_smallcount > m_small))
-            continue;
+            if(k == 0 && m_nozero) {
+                ++tries;
+                continue;
+            }
+
+            m_smallcount += small ? 1 : 0;
+            if(small && (m_smallcount > m_small)) {
+                ++tries;
+                continue;
+            }
+        }
 
         vals << k;
-        if(checkSames(vals))
+        if(!relax && checkSames(vals)) {
+            ++tries;
             continue;
+        }
 
-        if(checkInverseTerms(vals))
+        // Only a whole set of terms can be stale. The rejected value
+        // must come off again, or vals outgrows the term lists.
+        //
+        if(!relax && vals.size() == terms && checkInverseTerms(vals)) {
+            vals.removeLast();
+            ++tries;
             continue;
+        }
         ++j;
     }
 
-    for(int i = 0; i < vals.size(); ++i)
-        m_vals[i] << (i < terms ? vals[i] : INT_MIN);
+    for(int i = 0; i < m_vals.size(); ++i)
+        m_vals[i] << (i < vals.size() ? vals[i] : INT_MIN);
 
     return vals;
 }
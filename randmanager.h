@@ -9,15 +9,21 @@
 #define DEFAULT_INVERSE_TERMS rm_one
 #define SMALLEST_NUM 2  // Smallest number for problem terms
 #define MAX_SMALLNUM 1  // Max quantity of numbers less than MIN_SMALLNUMBER
+#define RETRY_LIMIT 1000 // Rejected values before getValues() relaxes a rule
 
 #define abs(x) (x < 0 ? (x * -1) : x)
 
 class RandManager
 {
 public:
-    RandManager(){}
+    RandManager() {m_inited = false; m_configKey = 0;
+                   m_seed = 0; m_seeded = false;}
     RandManager(int terms, int probs, QVector<int>& mins, QVector<int>& maxs);
     void init(int terms, int probs, QVector<int>& mins, QVector<int>& maxs);
+    bool update(int terms, int probs, QVector<int>& mins, QVector<int>& maxs);
+    static quint64 configKey(int terms, int probs,
+                             const QVector<int>& mins,
+                             const QVector<int>& maxs);
     bool isStale(QVector<int>& vals, int terms);
     QVector<int>& getValues(QVector<int>& vals);
     QVector<int>& getValues(QVector<int>& vals, int terms);
@@ -25,6 +31,7 @@ public:
     void setSames(int val) {m_sames = val;}
     void setSmall(int val) {m_small = val;}
     void setNoZero(bool z) {m_nozero = z;}
+    void setSeed(quint32 seed) {m_seed = seed; m_seeded = true;}
 
 private:
     int m_dimension;          // The number of terms to track
@@ -37,6 +44,10 @@ private:
     QVector<int> m_minList;   // List of min values of terms for each dimension
     QVector<int> m_maxList;   // List of max values of terms for each dimension
     CRandomMersenne m_rnd;    // Instance of Random Generator class
+    bool m_inited;            // init() has been called
+    quint64 m_configKey;      // configKey() of the arguments given to init()
+    quint32 m_seed;           // Seed from setSeed()
+    bool m_seeded;            // setSeed() has been called
 
     // QVector vVal is a container for the QVectors of values for each term.
     // Consider a problem set that can require up to three terms in the
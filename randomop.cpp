@@ -24,6 +24,7 @@
 **
 ******************************************************************************/
 
+#include <climits>
 #include <randomop.h>
 
 //#define DEBUG_RANDOP
@@ -37,6 +38,14 @@
 
 enum { prLeft, prRight };
 
+// Kinds of deck dealt by the constructive generators.
+//
+enum { deck_none, deck_div, deck_mod, deck_sqr, deck_sqrt };
+
+// Largest root whose square fits in an int.
+//
+#define MAXROOT 46340
+
 RandOp::RandOp()
 {
     init();
@@ -61,6 +70,7 @@ void RandOp::clear()
     m_qlPrRepeats[op_right].clear();
     m_qlLopRepeats.clear();
     m_qlRopRepeats.clear();
+    m_deckKind = deck_none;
     m_isMinMaxSet = false;  // initial value ...
 }
 
@@ -266,6 +276,79 @@ void RandOp::setCommutes(bool commutes)
     m_commutes = commutes;
 }
 
+// getDivPair - return a division problem that comes out even.
+//
+// The quotient and divisor are chosen, and the dividend is their
+// product, so there is no need to draw until the division comes out
+// even. The Left min/max values bound the quotient, which is the answer,
+// and the Right min/max values bound the divisor. The divisor is never
+// zero, and quotients whose dividend wouldn't fit in an int are left
+// out.
+//
+// QPoint ops - will contain the dividend (x) and the divisor (y).
+//
+void RandOp::getDivPair(QPoint& ops)
+{
+    int quotient;
+    int divisor;
+
+    getQuotient(quotient, divisor, false);
+    ops.setX(quotient * divisor);
+    ops.setY(divisor);
+}
+
+// getModPair - return a remainder problem.
+//
+// The same as getDivPair(), with a remainder from 0 to |divisor| - 1
+// added to the dividend. The remainder, which is the answer, takes the
+// sign of the dividend, as C's % operator does.
+//
+// QPoint ops - will contain the dividend (x) and the divisor (y).
+//
+void RandOp::getModPair(QPoint& ops)
+{
+    int quotient;
+    int divisor;
+
+    getQuotient(quotient, divisor, true);
+
+    int product = quotient * divisor;
+    int remainder = pRand->IRandomX(0, abs(divisor) - 1);
+
+    ops.setX(product < 0 ? product - remainder : product + remainder);
+    ops.setY(divisor);
+}
+
+// getSqrPair - return a problem that squares a number.
+//
+// The Left min/max values bound the number squared. Numbers whose
+// square wouldn't fit in an int are left out.
+//
+// QPoint ops - will contain the number (x) and its square (y).
+//
+void RandOp::getSqrPair(QPoint& ops)
+{
+    int root = getRoot(false);
+
+    ops.setX(root);
+    ops.setY(root * root);
+}
+
+// getSqrtPair - return a square root problem that comes out even.
+//
+// The root is chosen and squared. The Left min/max values bound the
+// root, which is the answer, and negative roots are left out.
+//
+// QPoint ops - will contain the perfect square (x) and its root (y).
+//
+void RandOp::getSqrtPair(QPoint& ops)
+{
+    int root = getRoot(true);
+
+    ops.setX(root * root);
+    ops.setY(root);
+}
+
 /***********************************************
 ** PRIVATE FUNCTIONS
 ************************************************/
@@ -397,6 +480,181 @@ bool RandOp::findMatchPair(int leftOp, int rightOp)
     return isRepeat;
 }
 
+// getQuotient - deal a quotient and divisor for getDivPair() and
+// getModPair().
+//
+// Each card of the deck is one quotient and divisor pair. A pair with a
+// zero quotient, or with a quotient or divisor of one, is passed over
+// while the caps on zeros and ones have been reached, unless the whole
+// deck has been passed over.
+//
+// bool mod - leave room in the dividend for a remainder
+//
+void RandOp::getQuotient(int& quotient, int& divisor, bool mod)
+{
+    qint64 dmin = qMin(m_Rmm.x(), m_Rmm.y());
+    qint64 dmax = qMax(m_Rmm.x(), m_Rmm.y());
+
+    if(dmin == 0 && dmax == 0)
+        dmin = dmax = 1;
+
+    // Zero is taken out of the divisors by counting past it.
+    //
+    bool spansZero = (dmin <= 0) && (dmax >= 0);
+    qint64 dcount = dmax - dmin + (spansZero ? 0 : 1);
+
+    // Limit the quotients so that the dividend fits in an int.
+    //
+    qint64 dabs = qMax(qAbs(dmin), qAbs(dmax));
+    qint64 qlimit = INT_MAX / dabs - (mod ? 1 : 0);
+    qint64 qmin = qBound(-qlimit, (qint64)qMin(m_Lmm.x(), m_Lmm.y()), qlimit);
+    qint64 qmax = qBound(-qlimit, (qint64)qMax(m_Lmm.x(), m_Lmm.y()), qlimit);
+    qint64 qcount = qmax - qmin + 1;
+
+    int kind = mod ? deck_mod : deck_div;
+    if(m_deckKind != kind)
+        startDeck(kind, (quint64)(qcount * dcount));
+
+    quint64 passed = 0;
+
+    for(;;) {
+        quint64 card = nextCard();
+        qint64 d = dmin + (qint64)(card % (quint64)dcount);
+
+        if(spansZero && d >= 0)
+            ++d;
+
+        quotient = (int)(qmin + (qint64)(card / (quint64)dcount));
+        divisor = (int)d;
+
+        bool isZero = (quotient == 0);
+        bool isOne = (quotient == 1) || (divisor == 1);
+
+        if(((isZero && m_zeroCount >= m_maxZeros)
+        ||  (isOne  && m_onesCount >= m_maxOnes))
+        && (++passed < m_deckSize))
+            continue;
+
+        if(isZero)
+            m_zeroCount++;
+        if(isOne)
+            m_onesCount++;
+        break;
+    }
+}
+
+// getRoot - deal a root for getSqrPair() and getSqrtPair().
+//
+// Roots of zero and one are passed over as getQuotient() does.
+//
+// bool sqrt - leave out negative roots
+//
+int RandOp::getRoot(bool sqrt)
+{
+    int rmin = qBound(-MAXROOT, qMin(m_Lmm.x(), m_Lmm.y()), MAXROOT);
+    int rmax = qBound(-MAXROOT, qMax(m_Lmm.x(), m_Lmm.y()), MAXROOT);
+
+    if(sqrt) {
+        rmin = qMax(rmin, 0);
+        rmax = qMax(rmax, 0);
+    }
+
+    int kind = sqrt ? deck_sqrt : deck_sqr;
+    if(m_deckKind != kind)
+        startDeck(kind, (quint64)(rmax - rmin + 1));
+
+    quint64 passed = 0;
+    int root;
+
+    for(;;) {
+        root = rmin + (int)nextCard();
+
+        bool isZero = (root == 0);
+        bool isOne = (root == 1);
+
+        if(((isZero && m_zeroCount >= m_maxZeros)
+        ||  (isOne  && m_onesCount >= m_maxOnes))
+        && (++passed < m_deckSize))
+            continue;
+
+        if(isZero)
+            m_zeroCount++;
+        if(isOne)
+            m_onesCount++;
+        break;
+    }
+    return root;
+}
+
+// startDeck - set up a deck of size cards for a generator.
+//
+// The cards are numbered 0 .. size-1. A card number is shuffled as two
+// halves, and each half needs enough bits for the whole number to hold
+// size - 1.
+//
+void RandOp::startDeck(int kind, quint64 size)
+{
+    int bits = 0;
+
+    while(bits < 64 && ((size - 1) >> bits) != 0)
+        ++bits;
+
+    m_deckKind = kind;
+    m_deckSize = size;
+    m_deckDealt = size;     // Shuffle before the first card is dealt
+    m_deckHalf = qMax(1, (bits + 1) / 2);
+}
+
+// nextCard - deal the next card of the deck, shuffling it first if all
+// of its cards have been dealt.
+//
+// The shuffle is a permutation of every number that fits in the card's
+// bits, which can be up to four times the size of the deck. A number
+// that lands past the deck is shuffled again until it lands in it, which
+// keeps the deal a permutation of just the deck.
+//
+quint64 RandOp::nextCard()
+{
+    if(m_deckDealt >= m_deckSize) {
+        for(int i = 0; i < 4; ++i)
+            m_deckKeys[i] = ((quint64)pRand->BRandom() << 32)
+                          | pRand->BRandom();
+        m_deckDealt = 0;
+    }
+
+    quint64 card = m_deckDealt++;
+
+    do {
+        card = shuffle(card);
+    } while(card >= m_deckSize);
+
+    return card;
+}
+
+// shuffle - a four round Feistel network over 2 * m_deckHalf bits.
+//
+// Each round mixes one half with a key and folds it into the other, so
+// any keys give a permutation.
+//
+quint64 RandOp::shuffle(quint64 card) const
+{
+    quint64 mask = ((quint64)1 << m_deckHalf) - 1;
+    quint64 left = card >> m_deckHalf;
+    quint64 right = card & mask;
+
+    for(int i = 0; i < 4; ++i) {
+        quint64 f = (right ^ m_deckKeys[i]) * 0x9e3779b97f4a7c15ULL;
+        f ^= f >> 29;
+        f *= 0xbf58476d1ce4e5b9ULL;
+        f ^= f >> 32;
+
+        quint64 temp = right;
+        right = (left ^ f) & mask;
+        left = temp;
+    }
+    return (left << m_deckHalf) | right;
+}
+
 // If it finds a match, returns true, else returns false.
 //
 bool RandOp::findMatch(int x, QList<int>& repeatList)
@@ -66,11 +66,25 @@ public:
                    int maxSames = DFLTMAXSAMES,
                    bool commutes = false);
 
+    // Constructive generators. These build a valid problem directly
+    // instead of drawing operands until one happens to fit. See the
+    // notes in randomop.cpp for how the min/max values are used.
+    //
+    void getDivPair(QPoint& ops);
+    void getModPair(QPoint& ops);
+    void getSqrPair(QPoint& ops);
+    void getSqrtPair(QPoint& ops);
+
 private:
     void init();
     bool findMatch(int x, QList<int>& repeatList);
     bool findMatchPair(int leftOp, int rightOp);
     void getTwoOps(QPoint& opr, bool swap);
+    void getQuotient(int& quotient, int& divisor, bool mod);
+    int getRoot(bool sqrt);
+    void startDeck(int kind, quint64 size);
+    quint64 nextCard();
+    quint64 shuffle(quint64 card) const;
 
     QList<int> m_qlLopRepeats;
     QList<int> m_qlRopRepeats;
@@ -102,6 +116,17 @@ private:
 
     QPoint m_Lmm;               // Left operand min/max values
     QPoint m_Rmm;               // Right operand min/max values
+
+    // The constructive generators deal their problems from a "deck" of
+    // every problem the min/max values allow, so none repeats until the
+    // deck is used up. The deck is a keyed shuffle of 0 .. size-1, and
+    // only the count of cards dealt is kept.
+    //
+    int m_deckKind;             // Which generator the deck is for
+    quint64 m_deckSize;         // Number of problems in the deck
+    quint64 m_deckDealt;        // Number dealt since the last shuffle
+    int m_deckHalf;             // Bits in each half of a card number
+    quint64 m_deckKeys[4];      // Keys of the shuffle
     CRandomMersenne *pRand;
 };
 
@@ -0,0 +1,650 @@
+#include <QtCore>
+
+#include <numformat.h>
+#include <testparm.h>
+#include <resultcolumns.h>
+
+#define COLUMNS_MAGIC       0x5243504d  // "MPCR" read as little-endian
+#define COLUMNS_VERSION     1
+#define BLOCK_MAGIC         0x4243504d  // "MPCB"
+
+struct ColumnFileHeader
+{
+    quint32 magic;
+    quint32 version;
+    quint32 headerSize;
+    quint32 reserved;
+};
+
+static_assert(sizeof(ColumnFileHeader) == ColumnReader::HeaderSize,
+              "ColumnFileHeader changed");
+static_assert(sizeof(ColumnBlockHeader) % 8 == 0, "ColumnBlockHeader changed");
+
+static inline quint32 align8(quint32 n)
+{
+    return (n + 7) & ~7u;
+}
+
+/***********************
+** ColumnBlock Routines
+***********************/
+
+//*******************************************************************
+QByteArray ColumnBlock::name(int row) const
+{
+    return nameAt(names()[row]);
+}
+
+//*******************************************************************
+QByteArray ColumnBlock::nameAt(int nameIndex) const
+{
+    return text(ColumnBlockHeader::NameIndex, ColumnBlockHeader::NameText,
+                nameIndex);
+}
+
+//*******************************************************************
+QByteArray ColumnBlock::correctAnswer(int row) const
+{
+    return text(ColumnBlockHeader::CorrectIndex,
+                ColumnBlockHeader::CorrectText, row);
+}
+
+//*******************************************************************
+QByteArray ColumnBlock::userAnswer(int row) const
+{
+    return text(ColumnBlockHeader::UserIndex, ColumnBlockHeader::UserText,
+                row);
+}
+
+//*******************************************************************
+int ColumnBlock::operandCount(int row) const
+{
+    const quint32* index = col<quint32>(ColumnBlockHeader::OperandIndex);
+    return index[row + 1] - index[row];
+}
+
+//*******************************************************************
+const qint32* ColumnBlock::operands(int row) const
+{
+    const quint32* index = col<quint32>(ColumnBlockHeader::OperandIndex);
+    return col<qint32>(ColumnBlockHeader::Operands) + index[row];
+}
+
+//*******************************************************************
+// text
+//
+// Returns entry i of a text column. The QByteArray points into the
+// block, so it is only good while the file is mapped.
+//
+QByteArray ColumnBlock::text(int indexColumn, int textColumn, int i) const
+{
+    const quint32* index = col<quint32>(indexColumn);
+    const char* chars = col<char>(textColumn);
+    return QByteArray::fromRawData(chars + index[i], index[i+1] - index[i]);
+}
+
+/***********************
+** ColumnWriter Routines
+***********************/
+
+//*******************************************************************
+ColumnWriter::ColumnWriter()
+{
+    clearBlock();
+}
+
+//*******************************************************************
+// open
+//
+// Open a file to append to, giving a new file its header. An existing
+// file must start with the header of this version, and is cut back to
+// the end of its last whole block, so that a block left partly written
+// by a crash doesn't hide the blocks appended after it. A file too short
+// to hold the header can't hold any answers, and is started over.
+//
+// The file is unbuffered, as blocks are written whole with one write,
+// and a failed one can then be cut off again by flush().
+//
+// Returns false if the file can't be opened or written, or isn't a file
+// of this version.
+//
+bool ColumnWriter::open(const QString& fileName)
+{
+    close();
+
+    m_file.setFileName(fileName);
+    if(!m_file.open(QIODevice::ReadWrite | QIODevice::Append
+                  | QIODevice::Unbuffered))
+        return false;
+
+    qint64 end = validEnd();
+    if(end < 0 || !m_file.resize(end)) {
+        m_file.close();
+        return false;
+    }
+
+    if(end == 0) {
+        ColumnFileHeader hdr;
+        hdr.magic = COLUMNS_MAGIC;
+        hdr.version = COLUMNS_VERSION;
+        hdr.headerSize = sizeof(hdr);
+        hdr.reserved = 0;
+
+        if(m_file.write((const char*)&hdr, sizeof(hdr)) != sizeof(hdr)) {
+            m_file.close();
+            return false;
+        }
+    }
+    return true;
+}
+
+//*******************************************************************
+// validEnd
+//
+// Walk the blocks of the open file the way ColumnReader does.
+//
+// Returns the offset just past the last good block, 0 if the file is
+// shorter than its header, or -1 if it can't be mapped or the header
+// isn't one of this version.
+//
+qint64 ColumnWriter::validEnd()
+{
+    qint64 size = m_file.size();
+    if(size < (qint64)sizeof(ColumnFileHeader))
+        return 0;
+
+    uchar* map = m_file.map(0, size);
+    if(map == 0)
+        return -1;
+
+    const ColumnFileHeader* fh = (const ColumnFileHeader*)map;
+    qint64 pos = -1;
+
+    if(fh->magic == COLUMNS_MAGIC && fh->version == COLUMNS_VERSION
+    && fh->headerSize == sizeof(ColumnFileHeader)) {
+        pos = fh->headerSize;
+        while(pos < size && ColumnReader::checkBlock(map + pos, size - pos))
+            pos += ((const ColumnBlockHeader*)(map + pos))->size;
+    }
+
+    m_file.unmap(map);
+    return pos;
+}
+
+//*******************************************************************
+void ColumnWriter::close()
+{
+    if(!m_file.isOpen())
+        return;
+
+    flush();
+    m_file.close();
+}
+
+//*******************************************************************
+// append
+//
+// Add one answer.
+//
+// tp        - the TestParm of the test, with the answer filled in
+// terms     - the problem's terms, if the caller has them
+// termCount - number of terms
+//
+// Returns false if a full block had to be written and that failed.
+//
+bool ColumnWriter::append(const TestParm& tp, const int* terms, int termCount)
+{
+    int name = m_names.indexOf(tp.testName);
+    if(name < 0) {
+        name = m_names.size();
+        m_names << tp.testName;
+    }
+
+    quint8 status = 0;
+    if(tp.isCorrect)
+        status |= ColumnBlock::Correct;
+    if(tp.isOnTime)
+        status |= ColumnBlock::OnTime;
+    if(tp.timeout > 0)
+        status |= ColumnBlock::Timed;
+
+    m_nsecs << tp.userNsecs;
+    m_pass << tp.pass;
+    for(int i = 0; i < termCount; ++i)
+        m_operands << terms[i];
+    m_operandIndex << (quint32)m_operands.size();
+    m_correctText += tp.correctAnswer.toUtf8();
+    m_correctIndex << (quint32)m_correctText.size();
+    m_userText += tp.userAnswer.toUtf8();
+    m_userIndex << (quint32)m_userText.size();
+    m_name << (quint16)name;
+    m_level << (quint8)tp.level;
+    m_status << status;
+
+    if(m_status.size() >= BlockRows)
+        return flush();
+    return true;
+}
+
+//*******************************************************************
+// flush
+//
+// Write the answers gathered so far as one block, with one write. If
+// the write fails, whatever part of the block got into the file is cut
+// off again, so the next block follows the last whole one.
+//
+// Returns false if the write failed. The answers are dropped either way.
+//
+bool ColumnWriter::flush()
+{
+    int rows = m_status.size();
+    if(rows == 0)
+        return true;
+
+    ColumnBlockHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+
+    // Names of the tests in the block
+    //
+    QVector<quint32> nameIndex;
+    QByteArray nameText;
+    nameIndex << 0;
+    for(int i = 0; i < m_names.size(); ++i) {
+        nameText += m_names[i].toUtf8();
+        nameIndex << (quint32)nameText.size();
+    }
+
+    // Stats for skipping the block
+    //
+    hdr.minNsecs = hdr.maxNsecs = m_nsecs[0];
+    hdr.minPass = hdr.maxPass = m_pass[0];
+    hdr.minLevel = hdr.maxLevel = m_level[0];
+    for(int i = 0; i < rows; ++i) {
+        hdr.minNsecs = qMin(hdr.minNsecs, m_nsecs[i]);
+        hdr.maxNsecs = qMax(hdr.maxNsecs, m_nsecs[i]);
+        hdr.minPass = qMin(hdr.minPass, m_pass[i]);
+        hdr.maxPass = qMax(hdr.maxPass, m_pass[i]);
+        hdr.minLevel = qMin(hdr.minLevel, m_level[i]);
+        hdr.maxLevel = qMax(hdr.maxLevel, m_level[i]);
+        if(m_status[i] & ColumnBlock::Correct)
+            hdr.correct++;
+    }
+
+    // Columns, in ColumnBlockHeader::Column order
+    //
+    const void* data[ColumnBlockHeader::ColumnCount] = {
+        m_nsecs.constData(), m_pass.constData(), m_operandIndex.constData(),
+        m_operands.constData(), m_correctIndex.constData(),
+        m_userIndex.constData(), nameIndex.constData(), m_name.constData(),
+        m_level.constData(), m_status.constData(), m_correctText.constData(),
+        m_userText.constData(), nameText.constData()
+    };
+    quint32 length[ColumnBlockHeader::ColumnCount] = {
+        quint32(rows * sizeof(qint64)), quint32(rows * sizeof(qint32)),
+        quint32((rows + 1) * sizeof(quint32)),
+        quint32(m_operands.size() * sizeof(qint32)),
+        quint32((rows + 1) * sizeof(quint32)),
+        quint32((rows + 1) * sizeof(quint32)),
+        quint32(nameIndex.size() * sizeof(quint32)),
+        quint32(rows * sizeof(quint16)), quint32(rows), quint32(rows),
+        quint32(m_correctText.size()), quint32(m_userText.size()),
+        quint32(nameText.size())
+    };
+
+    quint32 pos = align8(sizeof(hdr));
+    for(int c = 0; c < ColumnBlockHeader::ColumnCount; ++c) {
+        hdr.offset[c] = pos;
+        hdr.length[c] = length[c];
+        pos = align8(pos + length[c]);
+    }
+
+    hdr.magic = BLOCK_MAGIC;
+    hdr.size = pos;
+    hdr.rows = rows;
+    hdr.names = m_names.size();
+
+    m_block.resize(pos);
+    char* base = m_block.data();
+    memset(base, 0, pos);
+    memcpy(base, &hdr, sizeof(hdr));
+    for(int c = 0; c < ColumnBlockHeader::ColumnCount; ++c)
+        if(length[c])
+            memcpy(base + hdr.offset[c], data[c], length[c]);
+
+    clearBlock();
+
+    if(!m_file.isOpen())
+        return false;
+
+    qint64 start = m_file.size();
+    if(m_file.write(m_block) == m_block.size())
+        return true;
+
+    m_file.resize(start);
+    return false;
+}
+
+//*******************************************************************
+void ColumnWriter::clearBlock()
+{
+    m_names.clear();
+    m_nsecs.resize(0);
+    m_pass.resize(0);
+    m_operands.resize(0);
+    m_name.resize(0);
+    m_level.resize(0);
+    m_status.resize(0);
+    m_correctText.resize(0);
+    m_userText.resize(0);
+
+    m_operandIndex.resize(1);
+    m_correctIndex.resize(1);
+    m_userIndex.resize(1);
+    m_operandIndex[0] = m_correctIndex[0] = m_userIndex[0] = 0;
+}
+
+/***********************
+** ColumnReader Routines
+***********************/
+
+//*******************************************************************
+// open
+//
+// Map a file and find its blocks. A damaged or partial block ends the
+// file, and the blocks before it can still be read.
+//
+// Returns false if the file can't be mapped or has no valid header.
+//
+bool ColumnReader::open(const QString& fileName)
+{
+    close();
+
+    m_file.setFileName(fileName);
+    if(!m_file.open(QIODevice::ReadOnly))
+        return false;
+
+    m_size = m_file.size();
+    if(m_size < (qint64)sizeof(ColumnFileHeader)
+    || (m_map = m_file.map(0, m_size)) == 0) {
+        close();
+        return false;
+    }
+
+    const ColumnFileHeader* fh = (const ColumnFileHeader*)m_map;
+    if(fh->magic != COLUMNS_MAGIC || fh->version != COLUMNS_VERSION
+    || fh->headerSize != sizeof(ColumnFileHeader)) {
+        close();
+        return false;
+    }
+
+    qint64 pos = fh->headerSize;
+    while(pos < m_size && checkBlock(m_map + pos, m_size - pos)) {
+        m_blocks << m_map + pos;
+        pos += ((const ColumnBlockHeader*)(m_map + pos))->size;
+    }
+    return true;
+}
+
+//*******************************************************************
+void ColumnReader::close()
+{
+    m_blocks.clear();
+    if(m_map)
+        m_file.unmap(m_map);
+    m_map = 0;
+    m_size = 0;
+    m_file.close();
+}
+
+//*******************************************************************
+qint64 ColumnReader::rowCount() const
+{
+    qint64 rows = 0;
+    for(int i = 0; i < m_blocks.size(); ++i)
+        rows += block(i).rows();
+    return rows;
+}
+
+//*******************************************************************
+// checkBlock
+//
+// Make sure a block can be read without going outside it: every column
+// inside the block and the right size for the row count, every index
+// in order and within its text, and every name index in range.
+//
+// block - start of the block, 8 byte aligned
+// avail - bytes from there to the end of the file
+//
+bool ColumnReader::checkBlock(const uchar* block, qint64 avail)
+{
+    typedef ColumnBlockHeader H;
+
+    if(avail < (qint64)sizeof(H))
+        return false;
+
+    const H* hdr = (const H*)block;
+    if(hdr->magic != BLOCK_MAGIC || hdr->size < sizeof(H)
+    || hdr->size > avail || (hdr->size & 7) != 0)
+        return false;
+
+    for(int c = 0; c < H::ColumnCount; ++c)
+        if((hdr->offset[c] & 7) != 0
+        || (quint64)hdr->offset[c] + hdr->length[c] > hdr->size)
+            return false;
+
+    quint64 rows = hdr->rows;
+    quint64 names = hdr->names;
+    if(hdr->length[H::Nsecs] != rows * sizeof(qint64)
+    || hdr->length[H::Pass] != rows * sizeof(qint32)
+    || hdr->length[H::OperandIndex] != (rows + 1) * sizeof(quint32)
+    || hdr->length[H::Operands] % sizeof(qint32) != 0
+    || hdr->length[H::CorrectIndex] != (rows + 1) * sizeof(quint32)
+    || hdr->length[H::UserIndex] != (rows + 1) * sizeof(quint32)
+    || hdr->length[H::NameIndex] != (names + 1) * sizeof(quint32)
+    || hdr->length[H::Name] != rows * sizeof(quint16)
+    || hdr->length[H::Level] != rows || hdr->length[H::Status] != rows)
+        return false;
+
+    // Each index must run in order from 0 to the length of its data.
+    //
+    static const int indexes[4][3] = {
+        {H::OperandIndex, H::Operands, sizeof(qint32)},
+        {H::CorrectIndex, H::CorrectText, 1},
+        {H::UserIndex, H::UserText, 1},
+        {H::NameIndex, H::NameText, 1}
+    };
+    for(int k = 0; k < 4; ++k) {
+        const quint32* index =
+            (const quint32*)(block + hdr->offset[indexes[k][0]]);
+        quint64 count = hdr->length[indexes[k][0]] / sizeof(quint32);
+        quint64 end = hdr->length[indexes[k][1]] / indexes[k][2];
+
+        if(index[0] != 0 || index[count - 1] != end)
+            return false;
+        for(quint64 i = 1; i < count; ++i)
+            if(index[i] < index[i - 1])
+                return false;
+    }
+
+    const quint16* name = (const quint16*)(block + hdr->offset[H::Name]);
+    for(quint64 i = 0; i < rows; ++i)
+        if(name[i] >= names)
+            return false;
+
+    return true;
+}
+
+/***********************
+** Export Routines
+***********************/
+
+//*******************************************************************
+static void putNumber(QByteArray& out, qint64 v)
+{
+    char buf[24];
+    out.append(buf, (int)(nf::toChars(buf, buf + sizeof(buf), v) - buf));
+}
+
+//*******************************************************************
+// putCsv
+//
+// A CSV field, quoted if it holds a comma, a quote or a line break.
+//
+static void putCsv(QByteArray& out, const QByteArray& field)
+{
+    bool quote = false;
+    for(int i = 0; i < field.size() && !quote; ++i) {
+        char c = field[i];
+        quote = c == ',' || c == '"' || c == '\n' || c == '\r';
+    }
+
+    if(!quote) {
+        out += field;
+        return;
+    }
+
+    out += '"';
+    for(int i = 0; i < field.size(); ++i) {
+        if(field[i] == '"')
+            out += '"';
+        out += field[i];
+    }
+    out += '"';
+}
+
+//*******************************************************************
+// putJson
+//
+// A JSON string, with quotes, backslashes and control chars escaped.
+//
+static void putJson(QByteArray& out, const QByteArray& str)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    out += '"';
+    for(int i = 0; i < str.size(); ++i) {
+        uchar c = (uchar)str[i];
+        if(c == '"' || c == '\\') {
+            out += '\\';
+            out += (char)c;
+        } else if(c < 0x20) {
+            out += "\\u00";
+            out += hex[c >> 4];
+            out += hex[c & 15];
+        } else {
+            out += (char)c;
+        }
+    }
+    out += '"';
+}
+
+//*******************************************************************
+// exportCsv
+//
+// Write every answer as a line of CSV, with a heading line. Operands are
+// separated by spaces in one field.
+//
+// Returns false if a write failed.
+//
+bool ColumnReader::exportCsv(QIODevice* out) const
+{
+    QByteArray buf;
+    buf.reserve(64 * 1024);
+    buf += "test,level,pass,operands,correct_answer,user_answer,nsecs,"
+           "correct,on_time,timed\n";
+
+    for(int b = 0; b < m_blocks.size(); ++b) {
+        ColumnBlock blk = block(b);
+        for(int r = 0; r < blk.rows(); ++r) {
+            quint8 st = blk.status()[r];
+
+            putCsv(buf, blk.name(r));
+            buf += ',';
+            putNumber(buf, blk.levels()[r]);
+            buf += ',';
+            putNumber(buf, blk.passes()[r]);
+            buf += ',';
+            const qint32* ops = blk.operands(r);
+            for(int i = 0; i < blk.operandCount(r); ++i) {
+                if(i)
+                    buf += ' ';
+                putNumber(buf, ops[i]);
+            }
+            buf += ',';
+            putCsv(buf, blk.correctAnswer(r));
+            buf += ',';
+            putCsv(buf, blk.userAnswer(r));
+            buf += ',';
+            putNumber(buf, blk.nsecs()[r]);
+            buf += (st & ColumnBlock::Correct) ? ",1" : ",0";
+            buf += (st & ColumnBlock::OnTime) ? ",1" : ",0";
+            buf += (st & ColumnBlock::Timed) ? ",1\n" : ",0\n";
+
+            if(buf.size() >= 60 * 1024) {
+                if(out->write(buf) != buf.size())
+                    return false;
+                buf.resize(0);
+            }
+        }
+    }
+    return out->write(buf) == buf.size();
+}
+
+//*******************************************************************
+// exportJson
+//
+// Write every answer as an object in one JSON array.
+//
+// Returns false if a write failed.
+//
+bool ColumnReader::exportJson(QIODevice* out) const
+{
+    QByteArray buf;
+    bool first = true;
+
+    buf.reserve(64 * 1024);
+    buf += '[';
+
+    for(int b = 0; b < m_blocks.size(); ++b) {
+        ColumnBlock blk = block(b);
+        for(int r = 0; r < blk.rows(); ++r) {
+            quint8 st = blk.status()[r];
+
+            buf += first ? "\n{\"test\":" : ",\n{\"test\":";
+            first = false;
+            putJson(buf, blk.name(r));
+            buf += ",\"level\":";
+            putNumber(buf, blk.levels()[r]);
+            buf += ",\"pass\":";
+            putNumber(buf, blk.passes()[r]);
+            buf += ",\"operands\":[";
+            const qint32* ops = blk.operands(r);
+            for(int i = 0; i < blk.operandCount(r); ++i) {
+                if(i)
+                    buf += ',';
+                putNumber(buf, ops[i]);
+            }
+            buf += "],\"correctAnswer\":";
+            putJson(buf, blk.correctAnswer(r));
+            buf += ",\"userAnswer\":";
+            putJson(buf, blk.userAnswer(r));
+            buf += ",\"nsecs\":";
+            putNumber(buf, blk.nsecs()[r]);
+            buf += (st & ColumnBlock::Correct) ? ",\"correct\":true"
+                                               : ",\"correct\":false";
+            buf += (st & ColumnBlock::OnTime) ? ",\"onTime\":true"
+                                              : ",\"onTime\":false";
+            buf += (st & ColumnBlock::Timed) ? ",\"timed\":true}"
+                                             : ",\"timed\":false}";
+
+            if(buf.size() >= 60 * 1024) {
+                if(out->write(buf) != buf.size())
+                    return false;
+                buf.resize(0);
+            }
+        }
+    }
+
+    buf += "\n]\n";
+    return out->write(buf) == buf.size();
+}
@@ -0,0 +1,196 @@
+#ifndef RESULTCOLUMNS_H
+#define RESULTCOLUMNS_H
+
+#include <QFile>
+#include <QVector>
+#include <QByteArray>
+#include <QStringList>
+
+QT_BEGIN_NAMESPACE
+class QIODevice;
+QT_END_NAMESPACE
+
+class TestParm;
+
+//********************************************************************
+//
+// Columnar result files
+//
+// The results of every answer, as columns rather than lines of text, for
+// programs that go through a great many of them. A file is a short
+// header followed by blocks of up to ColumnWriter::BlockRows answers.
+// Each block holds one array per column and a ColumnBlockHeader giving
+// where each array is and the range of values in the block. A scan can
+// then skip a whole block from its header, or run down a single column
+// without touching the others.
+//
+// Columns, one entry per answer unless noted:
+//
+// Nsecs        - qint64 response time in nsecs, -1 if not measured
+// Pass         - qint32 pass of the test
+// OperandIndex - quint32 rows+1 offsets into Operands
+// Operands     - qint32 terms of each problem, as given to the writer
+// CorrectIndex - quint32 rows+1 offsets into CorrectText
+// UserIndex    - quint32 rows+1 offsets into UserText
+// NameIndex    - quint32 names+1 offsets into NameText
+// Name         - quint16 index of the test name among the block's names
+// Level        - quint8 level of the test
+// Status       - quint8 ColumnBlock::Correct, OnTime and Timed bits
+// CorrectText  - UTF-8 correct answers
+// UserText     - UTF-8 user answers
+// NameText     - UTF-8 names of the tests in the block
+//
+// Blocks hold their own names, so every block can be read by itself and
+// a file cut short by a crash is good up to its last whole block.
+//
+struct ColumnBlockHeader
+{
+    enum Column {
+        Nsecs, Pass, OperandIndex, Operands, CorrectIndex, UserIndex,
+        NameIndex, Name, Level, Status, CorrectText, UserText, NameText,
+        ColumnCount
+    };
+
+    quint32 magic;
+    quint32 size;               // Whole block, header included
+    quint32 rows;
+    quint32 names;
+    qint64 minNsecs;
+    qint64 maxNsecs;
+    qint32 minPass;
+    qint32 maxPass;
+    quint8 minLevel;
+    quint8 maxLevel;
+    quint16 reserved;
+    quint32 correct;            // Number of correct answers
+    quint32 offset[ColumnCount];    // From the start of the block
+    quint32 length[ColumnCount];    // In bytes
+};
+
+//********************************************************************
+//
+// class ColumnBlock
+//
+// A view of one block of a mapped file. The column pointers can be used
+// directly for scans.
+//
+class ColumnBlock
+{
+public:
+    enum { Correct = 0x01, OnTime = 0x02, Timed = 0x04 };
+
+    ColumnBlock() {m_hdr = 0; m_base = 0;}
+    ColumnBlock(const uchar* base) {m_base = base;
+        m_hdr = (const ColumnBlockHeader*)base;}
+
+    const ColumnBlockHeader& header() const {return *m_hdr;}
+    int rows() const {return m_hdr->rows;}
+
+    const qint64* nsecs() const {return col<qint64>(ColumnBlockHeader::Nsecs);}
+    const qint32* passes() const {return col<qint32>(ColumnBlockHeader::Pass);}
+    const quint16* names() const {return col<quint16>(ColumnBlockHeader::Name);}
+    const quint8* levels() const {return col<quint8>(ColumnBlockHeader::Level);}
+    const quint8* status() const
+        {return col<quint8>(ColumnBlockHeader::Status);}
+
+    QByteArray name(int row) const;
+    QByteArray nameAt(int nameIndex) const;
+    QByteArray correctAnswer(int row) const;
+    QByteArray userAnswer(int row) const;
+    int operandCount(int row) const;
+    const qint32* operands(int row) const;
+
+    template <class T>
+    const T* col(int column) const
+        {return (const T*)(m_base + m_hdr->offset[column]);}
+
+private:
+    const ColumnBlockHeader* m_hdr;
+    const uchar* m_base;
+
+    QByteArray text(int indexColumn, int textColumn, int i) const;
+};
+
+//********************************************************************
+//
+// class ColumnWriter
+//
+// Appends answers to a columnar result file. Answers are gathered in
+// memory and written a block at a time, when the block is full and on
+// flush() or close().
+//
+class ColumnWriter
+{
+public:
+    enum { BlockRows = 4096 };
+
+    ColumnWriter();
+    ~ColumnWriter() {close();}
+
+    bool open(const QString& fileName);
+    bool flush();
+    void close();
+    bool isOpen() {return m_file.isOpen();}
+
+    bool append(const TestParm& tp, const int* terms = 0, int termCount = 0);
+
+private:
+    Q_DISABLE_COPY(ColumnWriter)
+
+    QFile m_file;
+    QStringList m_names;            // The block's test names
+    QVector<qint64> m_nsecs;
+    QVector<qint32> m_pass;
+    QVector<quint32> m_operandIndex;
+    QVector<qint32> m_operands;
+    QVector<quint32> m_correctIndex;
+    QVector<quint32> m_userIndex;
+    QVector<quint16> m_name;
+    QVector<quint8> m_level;
+    QVector<quint8> m_status;
+    QByteArray m_correctText;
+    QByteArray m_userText;
+    QByteArray m_block;             // A block being written, kept for reuse
+
+    void clearBlock();
+    qint64 validEnd();
+};
+
+//********************************************************************
+//
+// class ColumnReader
+//
+// Maps a columnar result file and checks the layout of every block once,
+// after which the blocks are read in place.
+//
+class ColumnReader
+{
+public:
+    enum { HeaderSize = 16 };   // File header, before the first block
+
+    ColumnReader() {m_map = 0; m_size = 0;}
+    ~ColumnReader() {close();}
+
+    bool open(const QString& fileName);
+    void close();
+
+    int blockCount() const {return m_blocks.size();}
+    ColumnBlock block(int index) const {return ColumnBlock(m_blocks[index]);}
+    qint64 blockOffset(int index) const {return m_blocks[index] - m_map;}
+    qint64 rowCount() const;
+
+    bool exportCsv(QIODevice* out) const;
+    bool exportJson(QIODevice* out) const;
+
+    static bool checkBlock(const uchar* block, qint64 avail);
+
+private:
+    Q_DISABLE_COPY(ColumnReader)
+
+    QFile m_file;
+    uchar* m_map;
+    qint64 m_size;
+    QVector<const uchar*> m_blocks;
+};
+
+#endif // RESULTCOLUMNS_H
@@ -6,6 +6,7 @@
 #include <testparm.h>
 #include <testparmmanager.h>
 #include <resultfilemanager.h>
+#include <resultcolumns.h>
 
 static QString deco =
 "***************************************************************************\n";
@@ -23,23 +24,101 @@ static QString header = decoLine %
 ResultFileManager::ResultFileManager()
 {
     m_haveFile = false;
+    m_pAsync = 0;
+    m_pBase = &m_fileSink;
+    m_pSink = &m_fileSink;
+    m_pColumns = 0;
+}
+
+ResultFileManager::~ResultFileManager()
+{
+    setAsync(false);
 }
 
 void ResultFileManager::init(QFile *pFile)
 {
+    // Let the writer thread finish with the old file before it goes.
+    //
+    bool async = isAsync();
+    setAsync(false);
+
     if(m_haveFile)
         delete m_pFile;
 
     m_pFile = pFile;
     m_haveFile = true;
+    m_fileSink.setFile(pFile);
+
+    if(async)
+        setAsync(true);
+}
+
+//*******************************************************************
+// setAsync
+//
+// Turn the writer thread on or off. Turning it off waits for everything
+// queued to be written.
+//
+// flushMsecs - how long written lines may wait before being flushed
+//
+void ResultFileManager::setAsync(bool enable, int flushMsecs)
+{
+    if(m_pAsync) {
+        delete m_pAsync;
+        m_pAsync = 0;
+        m_pSink = m_pBase;
+    }
+
+    if(enable) {
+        m_pAsync = new AsyncSink(m_pBase, flushMsecs);
+        m_pSink = m_pAsync;
+    }
+}
+
+//*******************************************************************
+// setSink
+//
+// Write the log to a sink of the caller's, e.g. a ShardSink, instead of
+// the file given to init(). The sink is not owned. Pass 0 to go back to
+// the file.
+//
+void ResultFileManager::setSink(ResultSink* sink)
+{
+    bool async = isAsync();
+    setAsync(false);
+
+    m_pBase = sink ? sink : &m_fileSink;
+    m_pSink = m_pBase;
+
+    if(async)
+        setAsync(true);
+}
+
+//*******************************************************************
+// put
+//
+// Send text to the sink as UTF-8. The whole log is UTF-8: the rows from
+// RowFormatter are too, and ResultIndex reads it back as such.
+//
+// mode - NoFlush, Flush, or Sync to wait until it's on disk
+//
+bool ResultFileManager::put(const QString& text, int mode)
+{
+    bool ok = m_pSink->write(text.toUtf8());
+
+    if(mode == Flush)
+        ok = m_pSink->flush() && ok;
+    else if(mode == Sync)
+        ok = m_pSink->sync() && ok;
+
+    return ok;
 }
 
 bool ResultFileManager::startFile(QString &userName, QString &timeStamp)
 {
-    if((m_haveFile == false) || (m_pFile->isOpen() == false))
+    if(!isOpen())
         return false;
 
-    QTextStream stream(m_pFile);
     QString nameAndDate =
             "**   User Name: " % userName % "  Date & Time: " % timeStamp;
     QString spaces;
@@ -48,18 +127,15 @@ bool ResultFileManager::startFile(QString &userName, QString &timeStamp)
     spaces.fill(' ');
     spaces.append("**\n");
 
-    stream << deco << nameAndDate << spaces << deco << endl;
-    stream.flush();
-    return true;
+    return put(deco % nameAndDate % spaces % deco % "\n", Flush);
 }
 
 bool ResultFileManager::startTest(TestParmManager *ptm)
 {
-    if((m_haveFile == false) || (m_pFile->isOpen() == false))
+    if(!isOpen())
         return false;
 
     TestParm* testParm = ptm->getTestParm();
-    QTextStream stream(m_pFile);
 
     QString tmo = (testParm->timeout == -1)
             ? QString("none")
@@ -71,74 +147,60 @@ bool ResultFileManager::startTest(TestParmManager *ptm)
                 .arg(tmo)
                 .arg(testParm->level+1);
 
-    stream << title << header;
-    stream.flush();
-    return true;
+    return put(title % header, Flush);
 }
 
 bool ResultFileManager::updateTest(TestParmManager *ptm)
 {
-    if((m_haveFile == false) || (m_pFile->isOpen() == false))
-        return false;
-
-    TestParm* testParm = ptm->getTestParm();
-    QTextStream stream(m_pFile);
-
-    QString logEntry = QString("%1. %2  %3  %4  ")
-            .arg(testParm->pass+1, 3)
-            .arg(testParm->problem, 12)
-            .arg(testParm->correctAnswer, 10)
-            .arg(testParm->userAnswer, 10);
-
-    if(testParm->timeout > 0)
-        logEntry += QString("%1  ").arg(testParm->userTime);
-
-    logEntry += testParm->isCorrect ? "Correct" : "Wrong";
-
-    if(testParm->timeout > 0)
-        logEntry += testParm->isOnTime ? "" : "  Timed out!";
+    return updateTest(ptm, QVector<int>());
+}
 
-    logEntry += "\n";
+bool ResultFileManager::updateTest(TestParmManager *ptm,
+                                   const QVector<int>& terms)
+{
+    if(m_pColumns)
+        m_pColumns->append(*ptm->getTestParm(), terms.constData(),
+                           terms.size());
 
-    stream << logEntry;
+    if(!isOpen())
+        return false;
 
-    return true;
+    // The row is formatted into a buffer that is reused from row to row,
+    // so formatting it allocates nothing.
+    //
+    m_row.format(*ptm->getTestParm());
+    return m_pSink->write(m_row.data(), m_row.size());
 }
 
 bool ResultFileManager::writeEndOfTest(TestParmManager *ptm)
 {
-    if((m_haveFile == false) || (m_pFile->isOpen() == false))
-        return false;
+    bool ok = m_pColumns == 0 || m_pColumns->flush();
 
-    QTextStream stream(m_pFile);
+    if(!isOpen())
+        return false;
 
     QString logEntry = QString("Your score %1%\n\n")
             .arg(ptm->getTestScore());
 
-    stream << logEntry;
-    stream.flush();
-    return true;
+    return put(logEntry, Sync) && ok;
 }
 
 bool ResultFileManager::writeFinals(TestParmManager *testParmManager)
 {
-    if((m_haveFile == false) || (m_pFile->isOpen() == false))
-        return false;
+    bool ok = m_pColumns == 0 || m_pColumns->flush();
 
-    QTextStream stream(m_pFile);
+    if(!isOpen())
+        return false;
 
     QString logEntry = decoLine % QString("Your Final Score: %1\n\n")
             .arg(testParmManager->getFinalScore());
 
-    stream << logEntry;
-    stream.flush();
-    return true;
+    return put(logEntry, Sync) && ok;
 }
 
 bool ResultFileManager::isOpen()
 {
-    if(m_haveFile)
-        return m_pFile->isOpen();
-    else
+    if(m_pBase == &m_fileSink && !m_haveFile)
         return false;
+    return m_pSink->isOpen();
 }
@@ -1,6 +1,12 @@
 #ifndef RESULTFILE_H
 #define RESULTFILE_H
 
+#include <QVector>
+#include <resultsink.h>
+#include <rowformatter.h>
+
+class ColumnWriter;
+
 QT_BEGIN_NAMESPACE
 class QString;
 class QFile;
@@ -9,14 +15,43 @@ QT_END_NAMESPACE
 class TestParm;
 class TestParmManager;
 
+//********************************************************************
+//
+// class ResultFileManager
+//
+// Writes the human-readable results of a test run, in UTF-8. Every line
+// goes through a ResultSink. By default that is a FileSink on the file given
+// to init(), written on the caller's thread.
+//
+// setAsync(true) puts an AsyncSink in front of it, so the file is written
+// from a thread of its own and answering a problem never waits on the
+// disk. The log is made durable at the end of each test and after the
+// finals. Don't write to getFile() directly while async is on.
+//
+// setSink() sends the log somewhere other than the file, such as a
+// session's share of a ResultShardStore.
+//// isOpen() asks the sink whether the log can still be written, and each
+// writing call returns false if its write failed.
+//
+// setColumnWriter() adds a columnar copy of each answer, for analytics.
+// The writer is not owned. updateTest() can be given the problem's terms
+// to store along with it. The columns are flushed at the end of each
+// test and after the finals, along with the log.
+//
 class ResultFileManager
 {
 public:
     ResultFileManager();
+    ~ResultFileManager();
     void init(QFile* file);
+    void setAsync(bool enable, int flushMsecs = 200);
+    bool isAsync() {return m_pAsync != 0;}
+    void setSink(ResultSink* sink);
     bool startFile(QString& userName, QString& timeStamp);
     bool startTest(TestParmManager* ptm);
     bool updateTest(TestParmManager* ptm);
+    bool updateTest(TestParmManager* ptm, const QVector<int>& terms);
+    void setColumnWriter(ColumnWriter* writer) {m_pColumns = writer;}
     bool writeEndOfTest(TestParmManager* ptm);
     bool writeFinals(TestParmManager* testParmManager);
     bool isOpen();
@@ -24,9 +59,18 @@ public:
     QFile* getFile() {return m_pFile;}
 
 private:
+    enum { NoFlush, Flush, Sync };
+
     QFile* m_pFile;
     bool m_haveFile;
+    FileSink m_fileSink;
+    AsyncSink* m_pAsync;
+    ResultSink* m_pBase;        // m_fileSink, or the caller's sink
+    ResultSink* m_pSink;        // m_pBase, or m_pAsync in front of it
+    RowFormatter m_row;
+    ColumnWriter* m_pColumns;
 
+    bool put(const QString& text, int mode);
     void startFileCommon(QString& userName, QString& timeStamp);
 };
 
@@ -0,0 +1,520 @@
+#include <QtCore>
+
+#include <resultcolumns.h>
+#include <resultindex.h>
+
+#define INDEX_MAGIC         0x5849504d  // "MPIX" read as little-endian
+#define INDEX_VERSION       1
+#define TAIL_BYTES          256         // Bytes hashed to spot a rewrite
+
+static_assert(sizeof(ResultIndexEntry) == 32, "ResultIndexEntry changed");
+
+//*******************************************************************
+// parseDay
+//
+// The date of a session from the time stamp in a result file heading,
+// in whichever of the usual forms it was written.
+//
+// Returns the Julian day, or 0 if it can't be made out.
+//
+static qint32 parseDay(const QString& stamp)
+{
+    static const char* formats[] = {
+        "yyyy-MM-dd", "MM/dd/yyyy", "M/d/yyyy", "dd.MM.yyyy", "yyyyMMdd", 0
+    };
+
+    QDateTime dt = QDateTime::fromString(stamp, Qt::TextDate);
+    if(!dt.isValid())
+        dt = QDateTime::fromString(stamp, Qt::ISODate);
+    if(dt.isValid())
+        return (qint32)dt.date().toJulianDay();
+
+    QString first = stamp.section(' ', 0, 0);
+    for(int i = 0; formats[i]; ++i) {
+        QDate d = QDate::fromString(first, formats[i]);
+        if(d.isValid())
+            return (qint32)d.toJulianDay();
+    }
+    return 0;
+}
+
+/***********************
+** ResultIndex Routines
+***********************/
+
+//*******************************************************************
+ResultIndex::ResultIndex()
+{
+    m_kind = Text;
+    m_defaultDay = 0;
+    reset();
+}
+
+//*******************************************************************
+// open
+//
+// Open a result file and bring its index up to date.
+//
+// fileName - the result file
+// user     - the user, for files that don't say
+// date     - the date, for files that don't say
+//
+// Returns false if the file can't be read.
+//
+bool ResultIndex::open(const QString& fileName, const QString& user,
+                       const QDate& date)
+{
+    close();
+
+    m_source.setFileName(fileName);
+    if(!m_source.open(QIODevice::ReadOnly))
+        return false;
+
+    m_defaultUser = user;
+    m_defaultDay = date.isValid() ? (qint32)date.toJulianDay() : 0;
+
+    QByteArray magic = m_source.peek(4);
+    m_kind = (magic == QByteArray("MPCR")) ? Columnar : Text;
+
+    if(!loadSidecar())
+        reset();
+
+    return update();
+}
+
+//*******************************************************************
+void ResultIndex::close()
+{
+    m_source.close();
+    reset();
+}
+
+//*******************************************************************
+// update
+//
+// Index whatever has been added to the file since it was last indexed,
+// and save the sidecar if anything changed.
+//
+// Returns false if the file can't be read.
+//
+bool ResultIndex::update()
+{
+    if(!m_source.isOpen())
+        return false;
+
+    qint64 size = m_source.size();
+    if(size < m_indexed)
+        reset();
+    if(size == m_indexed)
+        return true;
+
+    uchar* map = m_source.map(0, size);
+    if(map == 0)
+        return false;
+
+    if(m_indexed > 0 && tailHash(map, m_indexed) != m_tailHash)
+        reset();
+
+    qint64 before = m_indexed;
+    if(m_kind == Columnar)
+        scanColumnar(map, size);
+    else
+        scanText((const char*)map, size);
+
+    m_tailHash = tailHash(map, m_indexed);
+    m_source.unmap(map);
+
+    if(m_indexed != before)
+        saveSidecar();
+    return true;
+}
+
+//*******************************************************************
+// query
+//
+// Returns the indexes of the entries that match, in file order.
+//
+QVector<int> ResultIndex::query(const ResultQuery& q) const
+{
+    QVector<int> hits;
+    int user = -1;
+    int test = -1;
+
+    if(!q.user.isEmpty() && (user = m_users.indexOf(q.user)) < 0)
+        return hits;
+    if(!q.test.isEmpty() && (test = m_tests.indexOf(q.test)) < 0)
+        return hits;
+
+    qint32 from = q.from.isValid() ? (qint32)q.from.toJulianDay() : 0;
+    qint32 to = q.to.isValid() ? (qint32)q.to.toJulianDay() : 0x7fffffff;
+    bool byDay = q.from.isValid() || q.to.isValid();
+
+    for(int i = 0; i < m_entries.size(); ++i) {
+        const ResultIndexEntry& e = m_entries[i];
+
+        if((user >= 0 && e.user != user)
+        || (test >= 0 && e.test != test)
+        || (q.level >= 0 && e.level != q.level)
+        || ((e.status & q.statusMask) != (q.status & q.statusMask))
+        || (byDay && (e.day == 0 || e.day < from || e.day > to)))
+            continue;
+
+        hits << i;
+    }
+    return hits;
+}
+
+//*******************************************************************
+// readRecord
+//
+// Read an answer's line from a text file, or its whole block from a
+// columnar one, which ColumnBlock can then read at entry.row.
+//
+// Returns false if it can't be read.
+//
+bool ResultIndex::readRecord(const ResultIndexEntry& e, QByteArray& record)
+{
+    if(!m_source.isOpen() || !m_source.seek(e.offset))
+        return false;
+
+    record = m_source.read(e.length);
+    return record.size() == (int)e.length;
+}
+
+//*******************************************************************
+// reset
+//
+// Forget everything indexed, to scan from the start.
+//
+void ResultIndex::reset()
+{
+    m_users.clear();
+    m_tests.clear();
+    m_entries.clear();
+    m_indexed = 0;
+    m_tailHash = 0;
+    m_curUser = -1;
+    m_curDay = 0;
+    m_curTest = -1;
+    m_curLevel = 0;
+}
+
+//*******************************************************************
+// scanText
+//
+// Index the whole lines from m_indexed on. A last line with no newline
+// yet is left for the next update.
+//
+bool ResultIndex::scanText(const char* data, qint64 size)
+{
+    qint64 pos = m_indexed;
+
+    while(pos < size) {
+        const char* nl = (const char*)memchr(data + pos, '\n', size - pos);
+        if(nl == 0)
+            break;
+
+        qint64 length = nl - (data + pos);
+        textLine(data + pos, (int)length, pos);
+        pos += length + 1;
+    }
+
+    m_indexed = pos;
+    return true;
+}
+
+//*******************************************************************
+// textLine
+//
+// Take note of a line of a text result file: a user heading, a test
+// heading or an answer. Anything else is passed over.
+//
+// length - the line without its newline. A '\r' before the newline is
+//          stripped for matching but still counted in the entry.
+//
+void ResultIndex::textLine(const char* text, int length, qint64 offset)
+{
+    int size = length + 1;      // The whole line, CR and LF included
+
+    if(length > 0 && text[length - 1] == '\r')
+        --length;
+
+    QByteArray line = QByteArray::fromRawData(text, length);
+
+    // "**   User Name: name  Date & Time: stamp     **"
+    //
+    if(line.startsWith("**   User Name: ")) {
+        int at = line.indexOf("  Date & Time: ");
+        if(at < 0)
+            return;
+
+        QByteArray stamp = line.mid(at + 15).trimmed();
+        if(stamp.endsWith("**"))
+            stamp = stamp.left(stamp.size() - 2).trimmed();
+
+        m_curUser = intern(m_users, QString::fromUtf8(line.mid(16, at - 16)));
+        m_curDay = parseDay(QString::fromUtf8(stamp));
+        if(m_curDay == 0)
+            m_curDay = m_defaultDay;
+        return;
+    }
+
+    // "name,  count Problems,  Timeout: timeout,  Level level"
+    //
+    int at = line.indexOf(" Problems,  Timeout: ");
+    if(at > 0) {
+        int nameEnd = line.lastIndexOf(",  ", at);
+        int levelAt = line.lastIndexOf(",  Level ");
+        if(nameEnd <= 0 || levelAt < at)
+            return;
+
+        m_curTest = intern(m_tests, QString::fromUtf8(line.left(nameEnd)));
+        m_curLevel = line.mid(levelAt + 9).trimmed().toInt() - 1;
+        return;
+    }
+
+    // "pass. problem  correct  answer  [time  ]Correct|Wrong[  Timed out!]"
+    //
+    int i = 0;
+    while(i < length && text[i] == ' ')
+        ++i;
+    int digits = i;
+    while(i < length && text[i] >= '0' && text[i] <= '9')
+        ++i;
+    if(i == digits || i >= length || text[i] != '.' || m_curTest < 0)
+        return;
+
+    quint8 status = 0;
+    if(line.endsWith("  Timed out!")) {
+        status |= TimedOut;
+        line = QByteArray::fromRawData(text, length - 12);
+    }
+    if(line.endsWith("Correct"))
+        status |= Correct;
+    else if(!line.endsWith("Wrong"))
+        return;
+
+    if(m_curUser < 0)
+        m_curUser = intern(m_users, m_defaultUser);
+
+    ResultIndexEntry e;
+    memset(&e, 0, sizeof(e));
+    e.offset = offset;
+    e.length = (quint32)size;
+    e.row = 0;
+    e.day = m_curDay ? m_curDay : m_defaultDay;
+    e.user = (quint16)m_curUser;
+    e.test = (quint16)m_curTest;
+    e.level = (quint8)qMax(0, m_curLevel);
+    e.status = status;
+    m_entries << e;
+}
+
+//*******************************************************************
+// scanColumnar
+//
+// Index the whole blocks from m_indexed on. A block still being written,
+// or a damaged one, stops the scan.
+//
+bool ResultIndex::scanColumnar(const uchar* data, qint64 size)
+{
+    qint64 pos = m_indexed;
+
+    if(pos == 0) {
+        if(size < ColumnReader::HeaderSize)
+            return false;
+        pos = ColumnReader::HeaderSize;
+    }
+
+    int user = intern(m_users, m_defaultUser);
+    QVector<int> tests;
+
+    while(pos < size && ColumnReader::checkBlock(data + pos, size - pos)) {
+        ColumnBlock blk(data + pos);
+        const ColumnBlockHeader& hdr = blk.header();
+
+        tests.resize(hdr.names);
+        for(int k = 0; k < (int)hdr.names; ++k)
+            tests[k] = intern(m_tests, QString::fromUtf8(blk.nameAt(k)));
+
+        ResultIndexEntry e;
+        memset(&e, 0, sizeof(e));
+        e.offset = pos;
+        e.length = hdr.size;
+        e.day = m_defaultDay;
+        e.user = (quint16)user;
+
+        for(int r = 0; r < blk.rows(); ++r) {
+            quint8 st = blk.status()[r];
+            e.row = r;
+            e.test = (quint16)tests[blk.names()[r]];
+            e.level = blk.levels()[r];
+            e.status = 0;
+            if(st & ColumnBlock::Correct)
+                e.status |= Correct;
+            if((st & ColumnBlock::Timed) && !(st & ColumnBlock::OnTime))
+                e.status |= TimedOut;
+            m_entries << e;
+        }
+        pos += hdr.size;
+    }
+
+    m_indexed = pos;
+    return true;
+}
+
+//*******************************************************************
+int ResultIndex::intern(QStringList& list, const QString& name)
+{
+    int id = list.indexOf(name);
+    if(id < 0) {
+        id = list.size();
+        list << name;
+    }
+    return id;
+}
+
+//*******************************************************************
+// tailHash
+//
+// FNV-1a of the bytes just before end. If they change, the file was
+// rewritten rather than added to.
+//
+quint64 ResultIndex::tailHash(const uchar* data, qint64 end) const
+{
+    quint64 h = 0xcbf29ce484222325ULL;
+
+    for(qint64 i = qMax((qint64)0, end - TAIL_BYTES); i < end; ++i) {
+        h ^= data[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+//*******************************************************************
+// loadSidecar
+//
+// Returns false if there is no sidecar, or it doesn't belong with the
+// file as it was opened.
+//
+bool ResultIndex::loadSidecar()
+{
+    QFile file(sidecarName());
+    if(!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&file);
+    quint32 magic, version;
+    qint32 kind, defaultDay, count;
+    QString defaultUser;
+
+    in >> magic >> version >> kind;
+    if(magic != INDEX_MAGIC || version != INDEX_VERSION || kind != m_kind)
+        return false;
+
+    in >> defaultUser >> defaultDay;
+    if(defaultUser != m_defaultUser || defaultDay != m_defaultDay)
+        return false;
+
+    in >> m_indexed >> m_tailHash >> m_curUser >> m_curDay
+       >> m_curTest >> m_curLevel >> m_users >> m_tests >> count;
+
+    if(in.status() != QDataStream::Ok || count < 0) {
+        reset();
+        return false;
+    }
+
+    m_entries.resize(count);
+    int bytes = count * (int)sizeof(ResultIndexEntry);
+    if(in.readRawData((char*)m_entries.data(), bytes) != bytes) {
+        reset();
+        return false;
+    }
+    return true;
+}
+
+//*******************************************************************
+// saveSidecar
+//
+// Returns false if it couldn't be written, which only costs a rescan
+// next time.
+//
+bool ResultIndex::saveSidecar() const
+{
+    QSaveFile file(sidecarName());
+    if(!file.open(QIODevice::WriteOnly))
+        return false;
+
+    QDataStream out(&file);
+    out << (quint32)INDEX_MAGIC << (quint32)INDEX_VERSION << (qint32)m_kind
+        << m_defaultUser << m_defaultDay
+        << m_indexed << m_tailHash << m_curUser << m_curDay
+        << m_curTest << m_curLevel << m_users << m_tests
+        << (qint32)m_entries.size();
+
+    int bytes = m_entries.size() * (int)sizeof(ResultIndexEntry);
+    if(out.writeRawData((const char*)m_entries.constData(), bytes) != bytes) {
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
+
+/*************************
+** ResultCatalog Routines
+*************************/
+
+//*******************************************************************
+bool ResultCatalog::addFile(const QString& fileName, const QString& user,
+                            const QDate& date)
+{
+    ResultIndex* index = new ResultIndex;
+
+    if(!index->open(fileName, user, date)) {
+        delete index;
+        return false;
+    }
+
+    m_files << index;
+    return true;
+}
+
+//*******************************************************************
+// update
+//
+// Bring every file's index up to date.
+//
+void ResultCatalog::update()
+{
+    for(int i = 0; i < m_files.size(); ++i)
+        m_files[i]->update();
+}
+
+//*******************************************************************
+void ResultCatalog::clear()
+{
+    for(int i = 0; i < m_files.size(); ++i)
+        delete m_files[i];
+    m_files.clear();
+}
+
+//*******************************************************************
+// query
+//
+// Returns the matching answers of every file, file by file.
+//
+QVector<ResultCatalog::Hit> ResultCatalog::query(const ResultQuery& q) const
+{
+    QVector<Hit> hits;
+
+    for(int f = 0; f < m_files.size(); ++f) {
+        QVector<int> found = m_files[f]->query(q);
+        for(int i = 0; i < found.size(); ++i) {
+            Hit hit;
+            hit.file = f;
+            hit.entry = found[i];
+            hits << hit;
+        }
+    }
+    return hits;
+}
@@ -0,0 +1,169 @@
+#ifndef RESULTINDEX_H
+#define RESULTINDEX_H
+
+#include <QFile>
+#include <QDate>
+#include <QVector>
+#include <QStringList>
+
+//********************************************************************
+//
+// struct ResultIndexEntry
+//
+// Where one answer is in a result file, and what it can be looked up
+// by, in 32 bytes.
+//
+// offset - byte offset of the line, or of the block in a columnar file
+// length - length of the line, newline included, or of the block
+// row    - the answer's row in its block, 0 for text
+// day    - Julian day the session was run, 0 if not known
+// user   - index into the index's user names
+// test   - index into the index's test names
+// level  - level of the test, from 0 as in TestParm
+// status - ResultIndex::Correct and TimedOut bits
+//
+struct ResultIndexEntry
+{
+    qint64 offset;
+    quint32 length;
+    quint32 row;
+    qint32 day;
+    quint16 user;
+    quint16 test;
+    quint8 level;
+    quint8 status;
+    quint8 reserved[6];
+};
+
+//********************************************************************
+//
+// struct ResultQuery
+//
+// What to look for. Fields left at their defaults match anything.
+//
+struct ResultQuery
+{
+    ResultQuery() {level = -1; status = 0; statusMask = 0;}
+
+    QString user;
+    QString test;
+    int level;                  // From 0, as in TestParm
+    QDate from;                 // First day, inclusive
+    QDate to;                   // Last day, inclusive
+    int status;                 // Wanted status bits ...
+    int statusMask;             // ... of the ones given here
+};
+
+//********************************************************************
+//
+// class ResultIndex
+//
+// An index of the answers in one result file, kept next to it in a
+// sidecar file of the same name with ".idx" added. Text files written by
+// ResultFileManager and columnar files written by ColumnWriter can both
+// be indexed.
+//
+// open() loads the sidecar, or scans the file to make one. If the file
+// has grown since, only the new part is scanned, so a file being written
+// to can be opened again and again for next to nothing. If the part that
+// was indexed has changed, the file is scanned again from the start.
+//
+// query() goes through the entries, which are small and in one array,
+// and readRecord() seeks straight to an answer without reading the rest
+// of the file.
+//
+// Columnar files don't name the user or date. Give them to open().
+//
+class ResultIndex
+{
+public:
+    enum { Correct = 0x01, TimedOut = 0x02 };
+    enum Kind { Text, Columnar };
+
+    ResultIndex();
+
+    bool open(const QString& fileName, const QString& user = QString(),
+              const QDate& date = QDate());
+    bool update();
+    void close();
+
+    Kind kind() const {return m_kind;}
+    QString fileName() const {return m_source.fileName();}
+    int size() const {return m_entries.size();}
+    const ResultIndexEntry& entry(int index) const {return m_entries[index];}
+    QString userName(const ResultIndexEntry& e) const {return m_users[e.user];}
+    QString testName(const ResultIndexEntry& e) const {return m_tests[e.test];}
+
+    QVector<int> query(const ResultQuery& q) const;
+    bool readRecord(const ResultIndexEntry& e, QByteArray& record);
+
+private:
+    Q_DISABLE_COPY(ResultIndex)
+
+    QFile m_source;
+    Kind m_kind;
+    QString m_defaultUser;
+    qint32 m_defaultDay;
+
+    QStringList m_users;
+    QStringList m_tests;
+    QVector<ResultIndexEntry> m_entries;
+
+    // Where the scan got to, so it can carry on as the file grows.
+    //
+    qint64 m_indexed;           // Bytes of the file indexed
+    quint64 m_tailHash;         // Hash of the bytes just before m_indexed
+    qint32 m_curUser;
+    qint32 m_curDay;
+    qint32 m_curTest;
+    qint32 m_curLevel;
+
+    void reset();
+    bool scanText(const char* data, qint64 size);
+    bool scanColumnar(const uchar* data, qint64 size);
+    void textLine(const char* line, int length, qint64 offset);
+    int  intern(QStringList& list, const QString& name);
+    quint64 tailHash(const uchar* data, qint64 end) const;
+    bool loadSidecar();
+    bool saveSidecar() const;
+    QString sidecarName() const {return m_source.fileName() + ".idx";}
+};
+
+//********************************************************************
+//
+// class ResultCatalog
+//
+// A set of ResultIndexes, queried together.
+//
+class ResultCatalog
+{
+public:
+    struct Hit
+    {
+        int file;               // Index of the ResultIndex
+        int entry;              // Index of the entry in it
+    };
+
+    ResultCatalog() {}
+    ~ResultCatalog() {clear();}
+
+    bool addFile(const QString& fileName, const QString& user = QString(),
+                 const QDate& date = QDate());
+    void update();
+    void clear();
+
+    int fileCount() const {return m_files.size();}
+    ResultIndex* file(int index) {return m_files[index];}
+
+    QVector<Hit> query(const ResultQuery& q) const;
+    bool readRecord(const Hit& hit, QByteArray& record)
+        {return m_files[hit.file]->readRecord(
+                    m_files[hit.file]->entry(hit.entry), record);}
+
+private:
+    Q_DISABLE_COPY(ResultCatalog)
+
+    QList<ResultIndex*> m_files;
+};
+
+#endif // RESULTINDEX_H
@@ -0,0 +1,317 @@
+#include <QtCore>
+
+#if defined(Q_OS_WIN)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <resultshards.h>
+
+#define SHARD_MAGIC     0x5253504d  // "MPSR" read as little-endian
+
+// Frame put in front of every record in a shard file.
+//
+struct ShardRecord
+{
+    quint32 magic;
+    quint32 length;             // Bytes of data after the frame
+    quint64 session;
+};
+
+static_assert(sizeof(ShardRecord) == 16, "ShardRecord layout changed");
+
+/****************************
+** ResultShardStore Routines
+****************************/
+
+//*******************************************************************
+// ResultShardStore constructor
+//
+// dir        - directory for the shard files, which must exist
+// shards     - number of shard files
+// maxOpen    - most shard files open at once
+// batchBytes - bytes a shard gathers before writing them
+//
+ResultShardStore::ResultShardStore(const QString& dir, int shards,
+                                   int maxOpen, int batchBytes)
+{
+    m_dir = dir;
+    m_shardCount = qMax(1, shards);
+    m_maxOpen = qMax(1, maxOpen);
+    m_batchBytes = qMax(1, batchBytes);
+
+    for(int i = 0; i < m_shardCount; ++i) {
+        m_shards << new Shard;
+        m_shards[i]->file = 0;
+        m_shards[i]->indexed = false;
+        m_shards[i]->end = 0;
+    }
+}
+
+//*******************************************************************
+ResultShardStore::~ResultShardStore()
+{
+    flushAll();
+    for(int i = 0; i < m_shardCount; ++i)
+        delete m_shards[i]->file;
+    qDeleteAll(m_shards);
+}
+
+//*******************************************************************
+// append
+//
+// Add a record for a session. It's written with the rest of its shard's
+// batch.
+//
+// Returns false if the batch had to be written and that failed.
+//
+bool ResultShardStore::append(quint64 session, const char* data, int size)
+{
+    int shard = shardOf(session);
+    Shard* sh = m_shards[shard];
+    ShardRecord rec;
+
+    rec.magic = SHARD_MAGIC;
+    rec.length = (quint32)size;
+    rec.session = session;
+
+    QMutexLocker locker(&sh->lock);
+    if(indexShard(shard))
+        sh->index[session] << sh->end + sh->pending.size();
+    sh->pending.append((const char*)&rec, sizeof(rec));
+    sh->pending.append(data, size);
+
+    if(sh->pending.size() >= m_batchBytes)
+        return writeShard(shard, false);
+    return true;
+}
+
+//*******************************************************************
+bool ResultShardStore::flushAll()
+{
+    bool ok = true;
+    for(int i = 0; i < m_shardCount; ++i)
+        ok = flushShard(i, false) && ok;
+    return ok;
+}
+
+//*******************************************************************
+// readSession
+//
+// Collect the data of every record a session has written, in order.
+// Anything still waiting in the shard's batch is written first. Only
+// the session's own records are read, from the offsets in the index.
+//
+// Returns false if the shard file can't be read.
+//
+bool ResultShardStore::readSession(quint64 session, QByteArray& out)
+{
+    int shard = shardOf(session);
+    Shard* sh = m_shards[shard];
+    QVector<qint64> offsets;
+    qint64 size;
+
+    out.clear();
+
+    // Records are never changed once written, so the file is read after
+    // the shard's lock is let go.
+    //
+    {
+        QMutexLocker locker(&sh->lock);
+        if(!writeShard(shard, false) || !indexShard(shard))
+            return false;
+        offsets = sh->index.value(session);
+        size = sh->end;
+    }
+
+    if(offsets.isEmpty())
+        return true;
+
+    QFile file(shardFileName(shard));
+    if(!file.open(QIODevice::ReadOnly))
+        return false;
+
+    const uchar* map = file.map(0, size);
+    if(map == 0)
+        return false;
+
+    for(int i = 0; i < offsets.size(); ++i) {
+        ShardRecord rec;
+        qint64 pos = offsets[i];
+
+        memcpy(&rec, map + pos, sizeof(rec));
+        out.append((const char*)map + pos + sizeof(rec), rec.length);
+    }
+    return true;
+}
+
+//*******************************************************************
+// shardOf
+//
+// Returns the shard for a session. The id is mixed first, so sessions
+// numbered in sequence still spread over all the shards.
+//
+int ResultShardStore::shardOf(quint64 session) const
+{
+    session ^= session >> 33;
+    session *= 0xff51afd7ed558ccdULL;
+    session ^= session >> 33;
+    return (int)(session % (quint64)m_shardCount);
+}
+
+//*******************************************************************
+QString ResultShardStore::shardFileName(int shard) const
+{
+    return QString("%1/results-%2.shard").arg(m_dir)
+            .arg(shard, 3, 10, QChar('0'));
+}
+
+//*******************************************************************
+int ResultShardStore::openFileCount()
+{
+    QMutexLocker locker(&m_lruLock);
+    return m_lru.size();
+}
+
+//*******************************************************************
+bool ResultShardStore::flushShard(int shard, bool durable)
+{
+    QMutexLocker locker(&m_shards[shard]->lock);
+    return writeShard(shard, durable);
+}
+
+//*******************************************************************
+// writeShard
+//
+// Write a shard's batch with one write. The shard's lock must be held,
+// which keeps each shard's batches in order and its file open. No other
+// lock is held while writing or syncing.
+//
+// durable - also have the data put on disk before returning
+//
+bool ResultShardStore::writeShard(int shard, bool durable)
+{
+    Shard* sh = m_shards[shard];
+    if(sh->pending.isEmpty() && !durable)
+        return true;
+
+    QFile* file = openShard(shard);
+    if(file == 0)
+        return false;
+
+    bool ok = file->write(sh->pending) == sh->pending.size()
+           && file->flush();
+
+    // After a failed write the file may hold part of the batch, so the
+    // index is rebuilt from the file the next time it's needed.
+    //
+    sh->end += sh->pending.size();
+    sh->indexed = sh->indexed && ok;
+    sh->pending.resize(0);
+
+    if(ok && durable) {
+#if defined(Q_OS_WIN)
+        ok = _commit(file->handle()) == 0;
+#else
+        ok = ::fsync(file->handle()) == 0;
+#endif
+    }
+    return ok;
+}
+
+//*******************************************************************
+// indexShard
+//
+// Make sure a shard's index matches its file, by scanning the file if
+// it doesn't. The shard's lock must be held.
+//
+// The scan stops at the first frame that isn't whole or has no magic,
+// which is a torn record left by a crash. Records appended after it are
+// found through the index while the store lasts, but a later scan can't
+// step past it, as before.
+//
+// Returns false if the file can't be read.
+//
+bool ResultShardStore::indexShard(int shard)
+{
+    Shard* sh = m_shards[shard];
+
+    if(sh->indexed)
+        return true;
+
+    sh->index.clear();
+    sh->end = 0;
+
+    QFile file(shardFileName(shard));
+    if(file.exists()) {
+        if(!file.open(QIODevice::ReadOnly))
+            return false;
+
+        qint64 size = file.size();
+        const uchar* map = size > 0 ? file.map(0, size) : 0;
+        if(size > 0 && map == 0)
+            return false;
+
+        qint64 pos = 0;
+        while(size - pos >= (qint64)sizeof(ShardRecord)) {
+            ShardRecord rec;
+            memcpy(&rec, map + pos, sizeof(rec));
+
+            if(rec.magic != SHARD_MAGIC
+            || size - pos - (qint64)sizeof(rec) < rec.length)
+                break;
+
+            sh->index[rec.session] << pos;
+            pos += sizeof(rec) + rec.length;
+        }
+        sh->end = size;
+    }
+
+    sh->indexed = true;
+    return true;
+}
+
+//*******************************************************************
+// openShard
+//
+// Returns the open file for a shard, opening it if need be. The shard's
+// lock must be held.
+//
+// If too many files are open, those used longest ago are closed. A shard
+// that is busy writing is passed over rather than waited for, so for a
+// moment more than maxOpen files may be open.
+//
+QFile* ResultShardStore::openShard(int shard)
+{
+    Shard* sh = m_shards[shard];
+
+    if(sh->file) {
+        QMutexLocker locker(&m_lruLock);
+        m_lru.removeOne(shard);
+        m_lru.prepend(shard);
+        return sh->file;
+    }
+
+    QFile* file = new QFile(shardFileName(shard));
+    if(!file->open(QIODevice::WriteOnly | QIODevice::Append)) {
+        delete file;
+        return 0;
+    }
+    sh->file = file;
+
+    QMutexLocker locker(&m_lruLock);
+    m_lru.prepend(shard);
+
+    for(int i = m_lru.size() - 1; i > 0 && m_lru.size() > m_maxOpen; --i) {
+        Shard* old = m_shards[m_lru[i]];
+
+        if(old->lock.tryLock()) {
+            delete old->file;
+            old->file = 0;
+            old->lock.unlock();
+            m_lru.removeAt(i);
+        }
+    }
+    return file;
+}
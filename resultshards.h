@@ -0,0 +1,117 @@
+#ifndef RESULTSHARDS_H
+#define RESULTSHARDS_H
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+#include <QByteArray>
+#include <resultsink.h>
+
+QT_BEGIN_NAMESPACE
+class QFile;
+QT_END_NAMESPACE
+
+//********************************************************************
+//
+// class ResultShardStore
+//
+// One store of result logs for all the sessions of a server. Instead of
+// a file per session, the records of every session go into a few shard
+// files, chosen by session id, so the number of files stays the same
+// however many sessions there are.
+//
+// Each record is framed with its session id and length. Records are
+// gathered per shard and written in batches, when a shard has batchBytes
+// waiting and on flush(). Only maxOpen shard files are kept open at once.
+// The one used longest ago is closed to make room, so descriptors stay
+// bounded too.
+//
+// readSession() collects one session's records back out of its shard.
+// Each shard keeps the file offsets of every session's records, so the
+// read goes straight to them. The index of a shard file written before
+// the store was made is built by scanning the file once, the first time
+// the shard is used.
+//
+// All the calls are thread safe. Each shard is written under its own
+// lock, so sessions on different shards write and sync in parallel.
+// They only meet briefly to keep count of the open files.
+//
+class ResultShardStore
+{
+public:
+    ResultShardStore(const QString& dir, int shards = 8, int maxOpen = 4,
+                     int batchBytes = 64 * 1024);
+    ~ResultShardStore();
+
+    bool append(quint64 session, const char* data, int size);
+    bool flush(quint64 session) {return flushShard(shardOf(session), false);}
+    bool sync(quint64 session) {return flushShard(shardOf(session), true);}
+    bool flushAll();
+
+    bool readSession(quint64 session, QByteArray& out);
+
+    int shardCount() const {return m_shardCount;}
+    int shardOf(quint64 session) const;
+    QString shardFileName(int shard) const;
+    int openFileCount();
+
+private:
+    Q_DISABLE_COPY(ResultShardStore)
+
+    struct Shard
+    {
+        QMutex lock;            // Held while filling, writing or closing
+        QByteArray pending;     // Framed records not yet written
+        QFile* file;            // The shard file if open, else 0
+        bool indexed;           // index and end match the file
+        qint64 end;             // File size once pending is written
+        QHash<quint64, QVector<qint64> > index; // Record offsets by session
+    };
+
+    QString m_dir;
+    int m_shardCount;
+    int m_maxOpen;
+    int m_batchBytes;
+    QList<Shard*> m_shards;
+
+    QMutex m_lruLock;           // Guards m_lru
+    QList<int> m_lru;           // Shards with open files, most recent first
+
+    bool flushShard(int shard, bool durable);
+    bool writeShard(int shard, bool durable);
+    bool indexShard(int shard);
+    QFile* openShard(int shard);
+};
+
+//********************************************************************
+//
+// class ShardSink
+//
+// A ResultSink for one session, writing through a ResultShardStore. Give
+// it to ResultFileManager::setSink() to keep a session's log in the
+// store rather than in a file of its own. Once a write to the store
+// fails, isOpen() is false.
+//
+class ShardSink : public ResultSink
+{
+public:
+    ShardSink(ResultShardStore* store, quint64 session)
+        {m_store = store; m_session = session; m_failed = false;}
+
+    bool write(const char* data, int size)
+        {return check(m_store->append(m_session, data, size));}
+    bool flush() {return check(m_store->flush(m_session));}
+    bool sync() {return check(m_store->sync(m_session));}
+    bool isOpen() {return !m_failed;}
+
+private:
+    ResultShardStore* m_store;
+    quint64 m_session;
+    bool m_failed;              // A write to the store has failed
+
+    bool check(bool ok) {m_failed = m_failed || !ok; return ok;}
+};
+
+#endif // RESULTSHARDS_H
@@ -0,0 +1,301 @@
+#include <QtCore>
+
+#if defined(Q_OS_WIN)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <resultsink.h>
+
+/***********************
+** FileSink Routines
+***********************/
+
+//*******************************************************************
+bool FileSink::write(const char* data, int size)
+{
+    if(m_pFile == 0 || !m_pFile->isOpen())
+        return false;
+
+    return m_pFile->write(data, size) == size;
+}
+
+//*******************************************************************
+bool FileSink::isOpen()
+{
+    return m_pFile != 0 && m_pFile->isOpen();
+}
+
+//*******************************************************************
+bool FileSink::flush()
+{
+    if(m_pFile == 0 || !m_pFile->isOpen())
+        return false;
+
+    return m_pFile->flush();
+}
+
+//*******************************************************************
+// sync
+//
+// Flush the file, then have the operating system put it on disk.
+//
+bool FileSink::sync()
+{
+    if(!flush())
+        return false;
+
+    int fd = m_pFile->handle();
+    if(fd < 0)
+        return true;
+
+#if defined(Q_OS_WIN)
+    return _commit(fd) == 0;
+#else
+    return ::fsync(fd) == 0;
+#endif
+}
+
+/***********************
+** AsyncSink Routines
+***********************/
+
+//*******************************************************************
+// AsyncSink constructor
+//
+// target     - the sink to write to from the writer thread. Not owned.
+// flushMsecs - the longest the writer lets written data sit before
+//              flushing it
+// bufferSize - how much the writer gathers before writing it out
+//
+AsyncSink::AsyncSink(ResultSink* target, int flushMsecs, int bufferSize)
+    : m_writer(this)
+{
+    m_target = target;
+    m_flushMsecs = flushMsecs > 0 ? flushMsecs : 1;
+    m_bufferSize = bufferSize > 0 ? bufferSize : 1;
+
+    // The target is only asked whether it's open here, before the writer
+    // starts. After that only the writer thread touches it, and m_error
+    // carries its failures back.
+    //
+    m_error.store(target->isOpen() ? 0 : 1);
+
+    m_stub.next.store(0);
+    m_head.store(&m_stub);
+    m_tail = &m_stub;
+
+    m_writer.start();
+}
+
+//*******************************************************************
+AsyncSink::~AsyncSink()
+{
+    barrier(Stop);
+    m_writer.wait();
+}
+
+//*******************************************************************
+// write
+//
+// Queue a copy of the bytes for the writer.
+//
+// Returns false if an earlier write by the writer thread failed.
+//
+bool AsyncSink::write(const char* data, int size)
+{
+    Node* node = new Node;
+    node->data = QByteArray(data, size);
+    push(node, Data);
+    return !hasError();
+}
+
+//*******************************************************************
+bool AsyncSink::flush()
+{
+    push(new Node, Flush);
+    return !hasError();
+}
+
+//*******************************************************************
+// sync
+//
+// Wait until everything written so far is on disk.
+//
+// Returns false if any write, or the sync itself, failed.
+//
+bool AsyncSink::sync()
+{
+    return barrier(Sync) && !hasError();
+}
+
+//*******************************************************************
+// push
+//
+// Add a record to the queue and wake the writer. Safe from any thread.
+//
+void AsyncSink::push(Node* node, Kind kind)
+{
+    node->kind = kind;
+    node->next.store(0);
+
+    Node* prev = m_head.fetchAndStoreOrdered(node);
+    prev->next.storeRelease(node);
+    m_wake.release();
+}
+
+//*******************************************************************
+// barrier
+//
+// Queue a record and wait for the writer to get to it. The record lives
+// on this stack, since it is waited for.
+//
+bool AsyncSink::barrier(Kind kind)
+{
+    QSemaphore done;
+    bool result = true;
+    Node node;
+
+    node.done = &done;
+    node.result = &result;
+    push(&node, kind);
+    done.acquire();
+    return result;
+}
+
+//*******************************************************************
+// pop
+//
+// Take the oldest record off the queue. Writer thread only.
+//
+// Returns 0 if the queue is empty, or if a writer is halfway through
+// pushing the next record, in which case it will be there shortly.
+//
+AsyncSink::Node* AsyncSink::pop()
+{
+    Node* tail = m_tail;
+    Node* next = tail->next.loadAcquire();
+
+    if(tail == &m_stub) {
+        if(next == 0)
+            return 0;
+        m_tail = next;
+        tail = next;
+        next = next->next.loadAcquire();
+    }
+
+    if(next) {
+        m_tail = next;
+        return tail;
+    }
+
+    if(tail != m_head.loadAcquire())
+        return 0;
+
+    // tail is the last record. Put the stub behind it so it can be taken
+    // without leaving the queue with no nodes.
+    //
+    m_stub.next.store(0);
+    Node* prev = m_head.fetchAndStoreOrdered(&m_stub);
+    prev->next.storeRelease(&m_stub);
+
+    next = tail->next.loadAcquire();
+    if(next) {
+        m_tail = next;
+        return tail;
+    }
+    return 0;
+}
+
+//*******************************************************************
+// run
+//
+// The writer thread. Each record queued releases m_wake once, so after
+// each acquire there is one record to take, though it may take a moment
+// to be linked in.
+//
+// Data is flushed once the oldest unflushed write is flushMsecs old,
+// whether or not more writes keep coming. With nothing unflushed the
+// thread sleeps until the next record.
+//
+void AsyncSink::run()
+{
+    QByteArray buffer;
+    QElapsedTimer oldest;       // Started at the oldest unflushed write
+    bool unflushed = false;
+
+    buffer.reserve(m_bufferSize);
+
+    for(;;) {
+        if(unflushed) {
+            qint64 wait = m_flushMsecs - oldest.elapsed();
+
+            if(wait <= 0 || !m_wake.tryAcquire(1, (int)wait)) {
+                writeOut(buffer);
+                if(!m_target->flush())
+                    m_error.storeRelease(1);
+                unflushed = false;
+                continue;
+            }
+        } else {
+            m_wake.acquire();
+        }
+
+        Node* node;
+        while((node = pop()) == 0)
+            QThread::yieldCurrentThread();
+
+        switch(node->kind) {
+        case Data:
+            buffer.append(node->data);
+            if(!unflushed)
+                oldest.start();
+            unflushed = true;
+            if(buffer.size() >= m_bufferSize)
+                writeOut(buffer);
+            delete node;
+            break;
+
+        case Flush:
+            writeOut(buffer);
+            if(!m_target->flush())
+                m_error.storeRelease(1);
+            unflushed = false;
+            delete node;
+            break;
+
+        case Sync:
+            writeOut(buffer);
+            *node->result = m_target->sync();
+            if(!*node->result)
+                m_error.storeRelease(1);
+            unflushed = false;
+            node->done->release();
+            break;
+
+        case Stop:
+            writeOut(buffer);
+            *node->result = m_target->flush();
+            node->done->release();
+            return;
+        }
+    }
+}
+
+//*******************************************************************
+// writeOut
+//
+// Write the gathered data to the target and empty the buffer, keeping
+// its memory for the next lot.
+//
+void AsyncSink::writeOut(QByteArray& buffer)
+{
+    if(buffer.isEmpty())
+        return;
+
+    if(!m_target->write(buffer))
+        m_error.storeRelease(1);
+
+    buffer.resize(0);
+}
@@ -0,0 +1,146 @@
+#ifndef RESULTSINK_H
+#define RESULTSINK_H
+
+#include <QByteArray>
+#include <QAtomicPointer>
+#include <QSemaphore>
+#include <QThread>
+
+QT_BEGIN_NAMESPACE
+class QFile;
+QT_END_NAMESPACE
+
+//********************************************************************
+//
+// class ResultSink
+//
+// Where ResultFileManager sends the bytes of a result log.
+//
+// write()  - add bytes to the log
+// flush()  - hand what has been written to the operating system
+// sync()   - flush, and return only once the data is on disk
+// isOpen() - whether the log can still be written. False once it has
+//            no file, or a write has failed that the sink can't recover
+//            from.
+//
+class ResultSink
+{
+public:
+    virtual ~ResultSink() {}
+
+    virtual bool write(const char* data, int size) = 0;
+    virtual bool flush() = 0;
+    virtual bool sync() = 0;
+    virtual bool isOpen() = 0;
+
+    bool write(const QByteArray& data) {return write(data.constData(),
+                                                     data.size());}
+};
+
+//********************************************************************
+//
+// class FileSink
+//
+// Writes straight to a QFile on the caller's thread, which is how the
+// result log has always been written. The file is not owned.
+//
+class FileSink : public ResultSink
+{
+public:
+    FileSink(QFile* file = 0) {m_pFile = file;}
+
+    void setFile(QFile* file) {m_pFile = file;}
+    QFile* getFile() {return m_pFile;}
+
+    bool write(const char* data, int size);
+    bool flush();
+    bool sync();
+    bool isOpen();
+
+private:
+    QFile* m_pFile;
+};
+
+//********************************************************************
+//
+// class AsyncSink
+//
+// Passes the writes on to another sink from a thread of its own, so
+// that a slow disk never holds up the caller.
+//
+// write() copies the bytes into a record and pushes it onto a lock-free
+// queue. Any number of threads may write at once. The writer thread
+// gathers the records into one buffer and writes it out when it reaches
+// bufferSize. Written data is flushed at most flushMsecs after it was
+// written, even while more writes keep coming. flush() asks the writer
+// to write out its buffer soon. sync() is a barrier: it returns once
+// everything written before it is on disk.
+//
+// isOpen() is false once the target has failed a write, flush or sync,
+// or if it wasn't open to start with. It reads only the AsyncSink's own
+// error flag, never the target, which belongs to the writer thread.
+//
+// The other sink must only be used through the AsyncSink while the
+// AsyncSink exists. Deleting the AsyncSink writes out anything left and
+// stops the thread.
+//
+class AsyncSink : public ResultSink
+{
+public:
+    AsyncSink(ResultSink* target, int flushMsecs = 200,
+              int bufferSize = 64 * 1024);
+    ~AsyncSink();
+
+    bool write(const char* data, int size);
+    bool flush();
+    bool sync();
+    bool isOpen() {return !hasError();}
+
+    bool hasError() {return m_error.loadAcquire() != 0;}
+
+private:
+    Q_DISABLE_COPY(AsyncSink)
+
+    enum Kind { Data, Flush, Sync, Stop };
+
+    // A queued record. The queue is Vyukov's intrusive MPSC queue:
+    // writers swap themselves in at m_head, and the writer thread, the
+    // only consumer, follows the next links from m_tail.
+    //
+    struct Node
+    {
+        QAtomicPointer<Node> next;
+        QByteArray data;
+        Kind kind;
+        QSemaphore* done;       // Released once a Sync or Stop is done
+        bool* result;           // Set to the outcome of a Sync
+    };
+
+    class Writer : public QThread
+    {
+    public:
+        Writer(AsyncSink* sink) {m_sink = sink;}
+    protected:
+        void run() {m_sink->run();}
+    private:
+        AsyncSink* m_sink;
+    };
+
+    ResultSink* m_target;
+    int m_flushMsecs;
+    int m_bufferSize;
+    Writer m_writer;
+    QSemaphore m_wake;          // One for each record queued
+    QAtomicPointer<Node> m_head;
+    Node* m_tail;               // Writer thread only
+    Node m_stub;
+    QAtomicInt m_error;         // A write by the writer thread failed
+
+    void push(Node* node, Kind kind);
+    bool barrier(Kind kind);
+    Node* pop();
+    void run();
+    void writeOut(QByteArray& buffer);
+};
+
+#endif // RESULTSINK_H
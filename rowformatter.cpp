@@ -0,0 +1,126 @@
+#include <QtCore>
+
+#include <numformat.h>
+#include <testparm.h>
+#include <rowformatter.h>
+
+/**************************
+** RowFormatter Routines
+**************************/
+
+//*******************************************************************
+// format
+//
+// Format the line for the current pass of a test:
+//
+//   "pass. problem  correct  answer  [time  ]Correct|Wrong[  Timed out!]"
+//
+// with pass right aligned in 3 columns, the problem in 12 and each
+// answer in 10. The time and the time out only appear if the test has a
+// timeout.
+//
+// Returns the length of the line, which data() then points to.
+//
+int RowFormatter::format(const TestParm& tp)
+{
+    // Each UTF-16 unit is at most 3 bytes of UTF-8. Add room for the
+    // padding, two numbers and the fixed text.
+    //
+    int text = tp.problem.size() + tp.correctAnswer.size()
+             + tp.userAnswer.size();
+    int need = 3 * text + 12 + 10 + 10 + 2 * 11 + 64;
+
+    if(m_buf.size() < need)
+        m_buf.resize(need);
+
+    char* start = m_buf.data();
+    char* p = start;
+
+    p = putInt(p, tp.pass + 1, 3);
+    p = putAscii(p, ". ");
+    p = putText(p, tp.problem, 12);
+    p = putAscii(p, "  ");
+    p = putText(p, tp.correctAnswer, 10);
+    p = putAscii(p, "  ");
+    p = putText(p, tp.userAnswer, 10);
+    p = putAscii(p, "  ");
+
+    if(tp.timeout > 0) {
+        p = putInt(p, tp.userTime, 0);
+        p = putAscii(p, "  ");
+    }
+
+    p = putAscii(p, tp.isCorrect ? "Correct" : "Wrong");
+
+    if(tp.timeout > 0 && !tp.isOnTime)
+        p = putAscii(p, "  Timed out!");
+
+    *p++ = '\n';
+
+    m_size = (int)(p - start);
+    return m_size;
+}
+
+//*******************************************************************
+// putText
+//
+// Write text as UTF-8, right aligned in width columns. Longer text is
+// written whole. A lone surrogate is written as '?', as QString's own
+// conversion does.
+//
+char* RowFormatter::putText(char* p, const QString& text, int width)
+{
+    const QChar* s = text.constData();
+    int n = text.size();
+
+    for(int pad = width - n; pad > 0; --pad)
+        *p++ = ' ';
+
+    for(int i = 0; i < n; ++i) {
+        uint c = s[i].unicode();
+
+        if(c < 0x80) {
+            *p++ = char(c);
+        } else if(c < 0x800) {
+            *p++ = char(0xc0 | (c >> 6));
+            *p++ = char(0x80 | (c & 0x3f));
+        } else if(c >= 0xd800 && c < 0xdc00 && i + 1 < n
+               && s[i+1].unicode() >= 0xdc00 && s[i+1].unicode() < 0xe000) {
+            uint u = 0x10000 + ((c - 0xd800) << 10)
+                   + (s[++i].unicode() - 0xdc00);
+            *p++ = char(0xf0 | (u >> 18));
+            *p++ = char(0x80 | ((u >> 12) & 0x3f));
+            *p++ = char(0x80 | ((u >> 6) & 0x3f));
+            *p++ = char(0x80 | (u & 0x3f));
+        } else if(c >= 0xd800 && c < 0xe000) {
+            *p++ = '?';
+        } else {
+            *p++ = char(0xe0 | (c >> 12));
+            *p++ = char(0x80 | ((c >> 6) & 0x3f));
+            *p++ = char(0x80 | (c & 0x3f));
+        }
+    }
+    return p;
+}
+
+//*******************************************************************
+// putInt
+//
+// Write an integer right aligned in width columns. There is always room
+// for it, as format() sized the buffer.
+//
+char* RowFormatter::putInt(char* p, int value, int width)
+{
+    for(int pad = width - nf::digits((qint64)value); pad > 0; --pad)
+        *p++ = ' ';
+
+    return nf::toChars(p, p + 11, value);
+}
+
+//*******************************************************************
+char* RowFormatter::putAscii(char* p, const char* text)
+{
+    while(*text)
+        *p++ = *text++;
+    return p;
+}
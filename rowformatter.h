@@ -0,0 +1,44 @@
+#ifndef ROWFORMATTER_H
+#define ROWFORMATTER_H
+
+#include <QtGlobal>
+#include <QByteArray>
+
+QT_BEGIN_NAMESPACE
+class QString;
+QT_END_NAMESPACE
+
+class TestParm;
+
+//********************************************************************
+//
+// class RowFormatter
+//
+// Builds the line ResultFileManager::updateTest() writes for each
+// problem, straight into a byte buffer that is kept from line to line.
+// Once the buffer has grown to fit the longest line, formatting a line
+// allocates nothing.
+//
+// The text is UTF-8 and matches what the QString::arg() chain it replaces
+// gives, column for column. Widths are counted in UTF-16 code units, as
+// QString does.
+//
+class RowFormatter
+{
+public:
+    RowFormatter() {m_size = 0;}
+
+    int format(const TestParm& tp);
+    const char* data() const {return m_buf.constData();}
+    int size() const {return m_size;}
+
+private:
+    QByteArray m_buf;       // Capacity, grown as needed and never shrunk
+    int m_size;             // Length of the current line
+
+    static char* putText(char* p, const QString& text, int width);
+    static char* putInt(char* p, int value, int width);
+    static char* putAscii(char* p, const char* text);
+};
+
+#endif // ROWFORMATTER_H
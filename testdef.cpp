@@ -0,0 +1,382 @@
+#include <QtCore>
+
+#include <testparm.h>
+#include <testdef.h>
+
+// Keep the records packed. Their size is what every session pays per
+// test.
+//
+static_assert(sizeof(TestDef) == 28, "TestDef layout changed");
+static_assert(sizeof(TestRunState) == 16, "TestRunState layout changed");
+
+// Snapshot file layout. The header is followed by the TestDefs, the min
+// values, the max values and the string pool, each starting on a 4 byte
+// boundary at the offset the header gives for it.
+//
+#define SNAPSHOT_MAGIC      0x4454504d  // "MPTD" read as little-endian
+#define SNAPSHOT_VERSION    1
+#define SNAPSHOT_BYTEORDER  0x01020304
+
+struct SnapshotHeader
+{
+    quint32 magic;
+    quint32 version;
+    quint32 byteOrder;
+    quint32 defCount;
+    quint32 boundsCount;
+    quint32 stringsSize;
+    quint32 defsOffset;
+    quint32 minOffset;
+    quint32 maxOffset;
+    quint32 stringsOffset;
+    quint32 fileSize;
+    quint32 reserved;
+};
+
+static inline quint32 align4(quint32 offset)
+{
+    return (offset + 3) & ~3u;
+}
+
+/**************************
+** TestDefTable Routines
+**************************/
+
+//*******************************************************************
+TestDefTable::TestDefTable()
+{
+    m_mapFile = 0;
+    m_map = 0;
+    clear();
+}
+
+//*******************************************************************
+TestDefTable::~TestDefTable()
+{
+    unmap();
+}
+
+//*******************************************************************
+void TestDefTable::clear()
+{
+    unmap();
+    m_defStore.clear();
+    m_minStore.clear();
+    m_maxStore.clear();
+    m_stringStore.clear();
+    sync();
+}
+
+//*******************************************************************
+// append
+//
+// Add the configuration of one TestParm to the end of the table. Only
+// the limits for the TestParm's own level are kept.
+//
+// Returns the index of the new TestDef, or -1 if the TestParm has a
+// level, term count or number of limits too large for its field.
+//
+int TestDefTable::append(const TestParm& tp)
+{
+    TestDef def;
+    int lvl = tp.level;
+    int minTerms = 0;
+    int maxTerms = 0;
+
+    if(lvl >= 0 && lvl < tp.minterms.size())
+        minTerms = tp.minterms[lvl];
+    if(lvl >= 0 && lvl < tp.maxterms.size())
+        maxTerms = tp.maxterms[lvl];
+
+    // Min and max lists can differ in length. Keep as many as both have,
+    // the same as RandManager would use.
+    //
+    int bounds = 0;
+    if(lvl >= 0 && lvl < tp.minvals.size() && lvl < tp.maxvals.size())
+        bounds = qMin(tp.minvals[lvl].size(), tp.maxvals[lvl].size());
+
+    if(lvl < 0 || lvl > 0xff || minTerms < 0 || minTerms > 0xff
+    || maxTerms < 0 || maxTerms > 0xff || bounds > 0xffff)
+        return -1;
+
+    // A loaded or attached table is read-only. Bring it into the
+    // containers first.
+    //
+    if(!isOwned()) {
+        m_defStore = QVector<TestDef>(m_defs, m_defs + m_count);
+        m_minStore = QVector<qint32>(m_minVals, m_minVals + m_boundsSize);
+        m_maxStore = QVector<qint32>(m_maxVals, m_maxVals + m_boundsSize);
+        m_stringStore = QByteArray(m_strings, m_stringsSize);
+        unmap();
+    }
+
+    def.count = tp.count;
+    def.timeout = tp.timeout;
+    def.nameOffset = addString(tp.testName.toUtf8());
+    def.maskOffset = addString(tp.inputMask.toUtf8());
+    def.level = (quint8)lvl;
+    def.enabled = tp.isEnabled ? 1 : 0;
+    def.minTerms = (quint8)minTerms;
+    def.maxTerms = (quint8)maxTerms;
+    def.reserved[0] = def.reserved[1] = 0;
+
+    def.boundsOffset = m_minStore.size();
+    def.boundsCount = (quint16)bounds;
+    for(int i = 0; i < bounds; ++i) {
+        m_minStore << tp.minvals[lvl][i];
+        m_maxStore << tp.maxvals[lvl][i];
+    }
+
+    m_defStore << def;
+    sync();
+    return m_count - 1;
+}
+
+//*******************************************************************
+// build
+//
+// Replace the table with the configuration of every TestParm in a
+// TestParmManager's list, in the same order, so the indexes match.
+//
+// Returns false, leaving the table empty, if any TestParm can't be
+// appended.
+//
+bool TestDefTable::build(const QList<TestParm*>& list)
+{
+    clear();
+    m_defStore.reserve(list.size());
+
+    for(int i = 0; i < list.size(); ++i) {
+        if(append(*list[i]) < 0) {
+            clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+//*******************************************************************
+// totalCount
+//
+// Returns the number of problems in all the enabled tests.
+//
+int TestDefTable::totalCount() const
+{
+    int total = 0;
+
+    for(int i = 0; i < m_count; ++i)
+        if(m_defs[i].enabled)
+            total += m_defs[i].count;
+
+    return total;
+}
+
+//*******************************************************************
+// addString
+//
+// Put a NUL terminated string in the pool, unless it is already there.
+// Test names repeat at every level, so most are.
+//
+// Returns the offset of the string in the pool.
+//
+quint32 TestDefTable::addString(const QByteArray& utf8)
+{
+    int pos = 0;
+
+    while(pos < m_stringStore.size()) {
+        const char* s = m_stringStore.constData() + pos;
+        int len = qstrlen(s);
+        if(len == utf8.size() && memcmp(s, utf8.constData(), len) == 0)
+            return pos;
+        pos += len + 1;
+    }
+
+    m_stringStore.append(utf8.constData(), utf8.size());
+    m_stringStore.append('\0');
+    return pos;
+}
+
+//*******************************************************************
+// isOwned
+//
+// Returns true if the views point into the containers, rather than into
+// a snapshot from load() or attach().
+//
+bool TestDefTable::isOwned() const
+{
+    return m_defs == m_defStore.constData()
+        && m_minVals == m_minStore.constData()
+        && m_maxVals == m_maxStore.constData()
+        && m_strings == m_stringStore.constData();
+}
+
+//*******************************************************************
+// sync
+//
+// Point the views at the containers. This must follow any change to
+// them, because a container can move its data when it grows.
+//
+void TestDefTable::sync()
+{
+    m_defs = m_defStore.constData();
+    m_minVals = m_minStore.constData();
+    m_maxVals = m_maxStore.constData();
+    m_strings = m_stringStore.constData();
+    m_count = m_defStore.size();
+    m_boundsSize = m_minStore.size();
+    m_stringsSize = m_stringStore.size();
+}
+
+/**************************
+** Snapshot Routines
+**************************/
+
+//*******************************************************************
+// save
+//
+// Write the table to a snapshot file. The data goes to a temporary file
+// first, which replaces fileName only when all of it has been written,
+// so a crash or full disk never leaves a partial snapshot behind.
+//
+// Returns true on success.
+//
+bool TestDefTable::save(const QString& fileName) const
+{
+    SnapshotHeader hdr;
+
+    hdr.magic = SNAPSHOT_MAGIC;
+    hdr.version = SNAPSHOT_VERSION;
+    hdr.byteOrder = SNAPSHOT_BYTEORDER;
+    hdr.defCount = m_count;
+    hdr.boundsCount = m_boundsSize;
+    hdr.stringsSize = m_stringsSize;
+    hdr.defsOffset = align4(sizeof(hdr));
+    hdr.minOffset = align4(hdr.defsOffset + m_count * sizeof(TestDef));
+    hdr.maxOffset = align4(hdr.minOffset + m_boundsSize * sizeof(qint32));
+    hdr.stringsOffset = align4(hdr.maxOffset + m_boundsSize * sizeof(qint32));
+    hdr.fileSize = hdr.stringsOffset + m_stringsSize;
+    hdr.reserved = 0;
+
+    QByteArray image(hdr.fileSize, '\0');
+    char* base = image.data();
+
+    memcpy(base, &hdr, sizeof(hdr));
+    memcpy(base + hdr.defsOffset, m_defs, m_count * sizeof(TestDef));
+    memcpy(base + hdr.minOffset, m_minVals, m_boundsSize * sizeof(qint32));
+    memcpy(base + hdr.maxOffset, m_maxVals, m_boundsSize * sizeof(qint32));
+    memcpy(base + hdr.stringsOffset, m_strings, m_stringsSize);
+
+    QSaveFile file(fileName);
+    if(!file.open(QIODevice::WriteOnly))
+        return false;
+
+    if(file.write(image) != image.size()) {
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
+
+//*******************************************************************
+// load
+//
+// Replace the table with a snapshot file, mapped into memory.
+//
+// Returns false, leaving the table empty, if the file can't be mapped or
+// isn't a valid snapshot.
+//
+bool TestDefTable::load(const QString& fileName)
+{
+    clear();
+
+    QFile* file = new QFile(fileName);
+    uchar* map = 0;
+
+    if(file->open(QIODevice::ReadOnly))
+        map = file->map(0, file->size());
+
+    if(map == 0 || !attach(map, file->size())) {
+        delete file;
+        clear();
+        return false;
+    }
+
+    m_mapFile = file;
+    m_map = map;
+    return true;
+}
+
+//*******************************************************************
+// attach
+//
+// Point the table at a snapshot image already in memory. The memory must
+// stay put for as long as the table uses it. Every offset is checked
+// against the size of the image before anything is pointed at it.
+//
+// Returns false, leaving the table empty, if the image isn't valid.
+//
+bool TestDefTable::attach(const uchar* data, qint64 size)
+{
+    SnapshotHeader hdr;
+
+    clear();
+
+    if(size < (qint64)sizeof(hdr) || ((quintptr)data & 3) != 0)
+        return false;
+
+    memcpy(&hdr, data, sizeof(hdr));
+
+    if(hdr.magic != SNAPSHOT_MAGIC || hdr.version != SNAPSHOT_VERSION
+    || hdr.byteOrder != SNAPSHOT_BYTEORDER || hdr.fileSize > size)
+        return false;
+
+    quint64 defsEnd = hdr.defsOffset + (quint64)hdr.defCount * sizeof(TestDef);
+    quint64 minEnd = hdr.minOffset + (quint64)hdr.boundsCount * sizeof(qint32);
+    quint64 maxEnd = hdr.maxOffset + (quint64)hdr.boundsCount * sizeof(qint32);
+    quint64 strEnd = (quint64)hdr.stringsOffset + hdr.stringsSize;
+
+    if((hdr.defsOffset | hdr.minOffset | hdr.maxOffset) & 3
+    || defsEnd > hdr.fileSize || minEnd > hdr.fileSize
+    || maxEnd > hdr.fileSize || strEnd > hdr.fileSize)
+        return false;
+
+    const TestDef* defs = (const TestDef*)(data + hdr.defsOffset);
+    const char* strings = (const char*)(data + hdr.stringsOffset);
+
+    if(hdr.stringsSize > 0 && strings[hdr.stringsSize - 1] != '\0')
+        return false;
+
+    for(quint32 i = 0; i < hdr.defCount; ++i) {
+        const TestDef& def = defs[i];
+        if(def.nameOffset >= hdr.stringsSize
+        || def.maskOffset >= hdr.stringsSize
+        || (quint64)def.boundsOffset + def.boundsCount > hdr.boundsCount)
+            return false;
+    }
+
+    m_defs = defs;
+    m_minVals = (const qint32*)(data + hdr.minOffset);
+    m_maxVals = (const qint32*)(data + hdr.maxOffset);
+    m_strings = strings;
+    m_count = hdr.defCount;
+    m_boundsSize = hdr.boundsCount;
+    m_stringsSize = hdr.stringsSize;
+    return true;
+}
+
+//*******************************************************************
+// unmap
+//
+// Let go of a mapped snapshot, if there is one, and point the views
+// back at the (empty) containers.
+//
+void TestDefTable::unmap()
+{
+    if(m_mapFile) {
+        m_mapFile->unmap(m_map);
+        delete m_mapFile;
+        m_mapFile = 0;
+        m_map = 0;
+    }
+    sync();
+}
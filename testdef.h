@@ -0,0 +1,165 @@
+#ifndef TESTDEF_H
+#define TESTDEF_H
+
+#include <QList>
+#include <QVector>
+#include <QByteArray>
+
+QT_BEGIN_NAMESPACE
+class QString;
+class QFile;
+QT_END_NAMESPACE
+
+class TestParm;
+
+//********************************************************************
+//
+// struct TestDef
+//
+// The read-only part of a TestParm, for one test type at one level,
+// packed into 28 bytes. Strings and operand bounds are held by the
+// TestDefTable and found through the offsets here.
+//
+// count        - number of problems to be presented
+// timeout      - the max length of time allowed for each problem
+// nameOffset   - test name, UTF-8, in the table's string pool
+// maskOffset   - input mask, UTF-8, in the table's string pool
+// boundsOffset - first of this test's min and max operand values
+// boundsCount  - number of min and max values. 1 means the same limits
+//                apply to every term.
+// level        - the level of difficulty
+// enabled      - whether the test type is enabled to run
+// minTerms     - minimum number of terms for this level
+// maxTerms     - maximum number of terms for this level
+//
+struct TestDef
+{
+    qint32 count;
+    qint32 timeout;
+    quint32 nameOffset;
+    quint32 maskOffset;
+    quint32 boundsOffset;
+    quint16 boundsCount;
+    quint8 level;
+    quint8 enabled;
+    quint8 minTerms;
+    quint8 maxTerms;
+    quint8 reserved[2];
+};
+
+//********************************************************************
+//
+// struct TestRunState
+//
+// The part of a TestParm that changes as a session runs, packed into 16
+// bytes. A session keeps one of these for each TestDef in the table it
+// runs from.
+//
+// userTime     - how long the user took on the last problem, in msecs
+// pass         - the current test number in the set
+// numberCorrect- number of correct answers
+// flags        - Correct and OnTime for the last problem
+// percentScore - user score expressed as a percent of correct answers
+//
+struct TestRunState
+{
+    enum { Correct = 0x01, OnTime = 0x02 };
+
+    qint32 userTime;
+    qint32 pass;
+    qint32 numberCorrect;
+    quint8 flags;
+    quint8 percentScore;
+    quint8 reserved[2];
+
+    void clear() {userTime = 0; pass = 0; numberCorrect = 0;
+                  flags = OnTime; percentScore = 0;
+                  reserved[0] = reserved[1] = 0;}
+    bool isCorrect() const {return flags & Correct;}
+    bool isOnTime() const {return flags & OnTime;}
+};
+
+//********************************************************************
+//
+// class TestDefTable
+//
+// The test definitions of a whole drill application, in flat arrays.
+// The table is built once, from a TestParmManager's list of TestParms or
+// one TestParm at a time, and is not changed after that. Any number of
+// sessions, on any number of threads, can then read it at once. Each
+// session needs only its own array of TestRunState.
+//
+// The accessors read through plain pointers into the arrays, so the
+// table can also be laid over memory it doesn't own, e.g. a mapped file.
+//
+// Snapshots
+//
+// save() writes the table to a file in the same layout it has in memory,
+// behind a small header, and replaces the old file only once the new one
+// is complete. load() maps such a file and points the table straight at
+// it. Nothing is parsed or copied, only the header and offsets checked,
+// so a kiosk starts with its whole configuration a page-in away. The
+// table keeps the file mapped until it is cleared or destroyed.
+//
+// The file is in the byte order of the machine that wrote it. A file
+// from a machine of the other byte order is refused.
+//
+class TestDefTable
+{
+public:
+    TestDefTable();
+    ~TestDefTable();
+
+    void clear();
+    int append(const TestParm& tp);
+    bool build(const QList<TestParm*>& list);
+
+    bool save(const QString& fileName) const;
+    bool load(const QString& fileName);
+    bool attach(const uchar* data, qint64 size);
+    bool isMapped() const {return m_mapFile != 0;}
+
+    int size() const {return m_count;}
+    int totalCount() const;
+    const TestDef& def(int index) const {return m_defs[index];}
+    const char* name(int index) const
+        {return m_strings + m_defs[index].nameOffset;}
+    const char* inputMask(int index) const
+        {return m_strings + m_defs[index].maskOffset;}
+    int boundsCount(int index) const {return m_defs[index].boundsCount;}
+    const qint32* minVals(int index) const
+        {return m_minVals + m_defs[index].boundsOffset;}
+    const qint32* maxVals(int index) const
+        {return m_maxVals + m_defs[index].boundsOffset;}
+    int minTerms(int index) const {return m_defs[index].minTerms;}
+    int maxTerms(int index) const {return m_defs[index].maxTerms;}
+
+private:
+    Q_DISABLE_COPY(TestDefTable)
+
+    // Views of the table. These point into the containers below, or into
+    // a snapshot image.
+    //
+    const TestDef* m_defs;
+    const qint32* m_minVals;
+    const qint32* m_maxVals;
+    const char* m_strings;
+    int m_count;
+    int m_boundsSize;
+    int m_stringsSize;
+
+    QVector<TestDef> m_defStore;
+    QVector<qint32> m_minStore;
+    QVector<qint32> m_maxStore;
+    QByteArray m_stringStore;
+
+    QFile* m_mapFile;           // File the views point into, if any
+    uchar* m_map;
+
+    quint32 addString(const QByteArray& utf8);
+    bool isOwned() const;
+    void sync();
+    void unmap();
+};
+
+#endif // TESTDEF_H
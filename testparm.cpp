@@ -33,6 +33,7 @@ void TestParm::init(
     pass = 0;
     isOnTime = true;
     percentScore = 0;
+    userNsecs = -1;
     userAnswer.clear();
     letterScore.clear();
 }
@@ -1,13 +1,15 @@
 /******************************************************************************
 ** NOTE WELL:
-**      Many of the "get" functions return static data, so this class should
-**      not be considered reentrant. Use spinlocks for multithreaded apps.
+**      TestParm and TestParmManager hold all the state of one run of tests,
+**      so each thread must have its own. To run many sessions from one
+**      process, share a TestDefTable and give each session a TestSession.
 ******************************************************************************/
 
 #ifndef TESTPARM_H
 #define TESTPARM_H
 
 #include <randmanager.h>
+#include <teststats.h>
 
 namespace tp
 {
@@ -39,6 +41,8 @@ namespace tp
 // percentScore - user score expressed as a percent of corect answers
 // letterScore  - user score expressed as a letter (A - F)
 // userTime     - time it took the user to answer the current problem
+// userNsecs    - the same in nanoseconds, or -1 until it is measured
+// stats        - running statistics of all the answers to this test
 // maxterms     - maximum number of terms for this problem type
 // minterms     - minumum number of terms for this problem type
 // maxvals      - an array of max values for each term
@@ -99,8 +103,13 @@ public:
     QString correctAnswer;      // the correct answer expected
     QString userAnswer;         // answer given by the user
     int userTime;               // how long it took the user to answer
+    qint64 userNsecs;           // the same in nanoseconds
     QString letterScore;        // user's score as a letter grade
 
+    // Accumulated over every pass of every run, until cleared.
+    //
+    TestStats stats;            // response time and score statistics
+
 private:
 
 };
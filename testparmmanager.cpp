@@ -70,6 +70,7 @@ void TestParmManager::init()
     m_totalCount = 0;
     m_totalCorrect = 0;
     m_maxopsLoaded = false;
+    m_generatedAt = -1;
 }
 
 
@@ -84,6 +85,80 @@ void TestParmManager::initTest(int idx, int cnt, int tmo, int lvl, bool ena,
     m_running = true;
 }
 
+//*******************************************************************
+// loadDefTable
+//
+// Start over with one TestParm for each test in a TestDefTable, the
+// reverse of buildDefTable().
+//
+void TestParmManager::loadDefTable(const TestDefTable& table)
+{
+    for(int i = 0; i < m_testParmList.size(); ++i)
+        delete m_testParmList[i];
+
+    initInstance(table.size());
+
+    for(int i = 0; i < table.size(); ++i) {
+        const TestDef& def = table.def(i);
+        TestParm* pt = m_testParmList[i];
+        int lvl = def.level;
+        int bounds = def.boundsCount;
+
+        pt->init(def.count, def.timeout, lvl, def.enabled != 0,
+                 QString::fromUtf8(table.inputMask(i)),
+                 QString::fromUtf8(table.name(i)));
+
+        pt->minterms.resize(lvl + 1);
+        pt->maxterms.resize(lvl + 1);
+        pt->minvals.resize(lvl + 1);
+        pt->maxvals.resize(lvl + 1);
+
+        pt->minterms[lvl] = def.minTerms;
+        pt->maxterms[lvl] = def.maxTerms;
+        pt->minvals[lvl].resize(bounds);
+        pt->maxvals[lvl].resize(bounds);
+        for(int j = 0; j < bounds; ++j) {
+            pt->minvals[lvl][j] = table.minVals(i)[j];
+            pt->maxvals[lvl][j] = table.maxVals(i)[j];
+        }
+
+        if(def.enabled)
+            m_totalCount += def.count;
+    }
+    m_maxopsLoaded = true;
+}
+
+//*******************************************************************
+// saveSnapshot
+//
+// Returns true if the snapshot was written. Returns false, leaving the
+// file alone, if a TestParm doesn't fit in a TestDef.
+//
+bool TestParmManager::saveSnapshot(const QString& fileName)
+{
+    TestDefTable table;
+
+    if(!buildDefTable(table))
+        return false;
+    return table.save(fileName);
+}
+
+//*******************************************************************
+// loadSnapshot
+//
+// Returns false, leaving the current configuration alone, if the file
+// can't be read or isn't a valid snapshot.
+//
+bool TestParmManager::loadSnapshot(const QString& fileName)
+{
+    TestDefTable table;
+    if(!table.load(fileName))
+        return false;
+
+    loadDefTable(table);
+    return true;
+}
+
 /*******************************************
 ** Test State Machine
 *******************************************/
@@ -112,7 +187,7 @@ int TestParmManager::getNextTestIndex()
         && ! (pt = m_testParmList[idx])->isEnabled)
             ;
 
-        if(idx < m_totalCount) {
+        if(idx < m_testParmList.size()) {
             m_index = idx;
             pt->pass = 0;
         }
@@ -126,9 +201,19 @@ int TestParmManager::getNextTestIndex()
 //*******************************************************************
 // Update the passes of the same test.
 //
+// The answer just given is added to the statistics first, if its time
+// was taken with getElapsedTime().
+//
 void TestParmManager::updatePass()
 {
     TestParm* pt = m_testParmList[m_index];
+
+    if(pt->userNsecs >= 0) {
+        pt->stats.add(pt->userNsecs, pt->isCorrect);
+        m_stats.add(pt->userNsecs, pt->isCorrect);
+        pt->userNsecs = -1;
+    }
+
     pt->pass++;
     pt->isCorrect = false;
     pt->isOnTime = false;
@@ -172,28 +257,141 @@ void TestParmManager::writeFinals(Msg *pMsg)
     pMsg->sendMessage(text, LVLCHK(m_finalPercentScore));
 }
 
+//*******************************************************************
+// getTestScore, getFinalScore
+//
+// The score strings belong to the manager and are rebuilt on every call,
+// so each manager, and so each session, has its own.
+//
 QString& TestParmManager::getTestScore()
 {
     TestParm* pt = m_testParmList[m_index];
-    static QString score = QString("%1%  %2")
+    m_testScore = QString("%1%  %2")
             .arg(pt->percentScore).arg(pt->letterScore);
-    return score;
+    return m_testScore;
 }
 
 QString& TestParmManager::getFinalScore()
 {
-    static QString score = QString("%1%  %2")
+    m_finalScore = QString("%1%  %2")
             .arg(m_finalPercentScore).arg(m_finalLetterScore);
-    return score;
+    return m_finalScore;
+}
+
+//*******************************************************************
+// startTimer
+//
+// Start timing the user's response. If a problem was generated since
+// beginProblem(), the time it took to get here is its display time.
+// The problem's phase timing ends here, so a later endGeneration()
+// without a beginProblem() of its own counts nothing.
+//
+void TestParmManager::startTimer()
+{
+    if(m_generatedAt >= 0) {
+        qint64 ns = m_phaseTimer.nsecsElapsed() - m_generatedAt;
+        m_testParmList[m_index]->stats.addDisplay(ns);
+        m_stats.addDisplay(ns);
+    }
+    m_phaseTimer.invalidate();
+    m_generatedAt = -1;
+    m_timer.start();
+}
+
+//*******************************************************************
+// endGeneration
+//
+// Count the time since beginProblem() as generation time for the current
+// test, and start counting display time. Nothing is counted unless
+// beginProblem() was called for this problem and endGeneration() hasn't
+// been already.
+//
+void TestParmManager::endGeneration()
+{
+    if(!m_phaseTimer.isValid() || m_generatedAt >= 0)
+        return;
+
+    m_generatedAt = m_phaseTimer.nsecsElapsed();
+    m_testParmList[m_index]->stats.addGeneration(m_generatedAt);
+    m_stats.addGeneration(m_generatedAt);
 }
 
+//*******************************************************************
+// getElapsedTime
+//
+// Returns the user's response time in whole seconds. The full
+// resolution is kept in the TestParm's userNsecs for the stats.
+//
 int TestParmManager::getElapsedTime()
 {
     TestParm* pt = m_testParmList[m_index];
-    pt->userTime = m_timer.elapsed() / 1000;
+    pt->userNsecs = m_timer.nsecsElapsed();
+    pt->userTime = pt->userNsecs / 1000000000;
     return pt->userTime;
 }
 
+/*******************************************
+** Answer Statistics
+*******************************************/
+
+//*******************************************************************
+// getTestTypeStats
+//
+// Stats for one test type across all of its levels.
+//
+TestStats TestParmManager::getTestTypeStats(const QString& testName)
+{
+    TestStats stats;
+
+    for(int i = 0; i < m_testParmList.size(); ++i)
+        if(m_testParmList[i]->testName == testName)
+            stats.merge(m_testParmList[i]->stats);
+
+    return stats;
+}
+
+//*******************************************************************
+// getLevelStats
+//
+// Stats for one level of difficulty across all of the test types.
+//
+TestStats TestParmManager::getLevelStats(int level)
+{
+    TestStats stats;
+
+    for(int i = 0; i < m_testParmList.size(); ++i)
+        if(m_testParmList[i]->level == level)
+            stats.merge(m_testParmList[i]->stats);
+
+    return stats;
+}
+
+//*******************************************************************
+// mergeStats
+//
+// Fold in the stats gathered by another manager, e.g. one per session or
+// per thread. Per-test stats are merged by index, so both managers must
+// have been set up with the same tests in the same order.
+//
+void TestParmManager::mergeStats(TestParmManager& other)
+{
+    int count = qMin(m_testParmList.size(), other.m_testParmList.size());
+
+    for(int i = 0; i < count; ++i)
+        m_testParmList[i]->stats.merge(other.m_testParmList[i]->stats);
+
+    m_stats.merge(other.m_stats);
+}
+
+//*******************************************************************
+void TestParmManager::clearStats()
+{
+    for(int i = 0; i < m_testParmList.size(); ++i)
+        m_testParmList[i]->stats.clear();
+
+    m_stats.clear();
+}
+
 /*******************************************
 ** Access to the TestParm class
 *******************************************/
@@ -234,9 +432,29 @@ int TestParmManager::getCount()
 }
 
 //*******************************************************************
+// getRandman
+//
+// Each TestParm keeps its own RandManager, and with it the history of
+// values already presented, for as long as the test's configuration
+// stays the same. It is only set up again when the level, term count,
+// problem count or operand limits change.
+//
 RandManager& TestParmManager::getRandman()
 {
-    TestParm* pt = m_testParmList[m_index];
-    pt->randman.init(getMaxTerms(), getCount(), getMinVals(), getMaxVals());
+    return getRandman(m_index);
+}
+
+//*******************************************************************
+// getRandman
+//
+// The same, for any test rather than the current one.
+//
+RandManager& TestParmManager::getRandman(int index)
+{
+    TestParm* pt = m_testParmList[index];
+    int lvl = pt->level;
+
+    pt->randman.update(pt->maxterms[lvl], pt->count,
+                       pt->minvals[lvl], pt->maxvals[lvl]);
     return pt->randman;
 }
@@ -3,6 +3,8 @@
 
 #include <QtCore>
 #include <testparm.h>
+#include <testdef.h>
+#include <testplan.h>
 
 #define LVLCHK(score) ((score > 75) ? msg::msg_notify : msg::msg_alert)
 
@@ -43,7 +45,7 @@ public:
     void stopTest();
     int  getNextTestIndex();
     int  getCurrentTestIndex() {return m_index;}
-    void startTimer() {m_timer.start();}
+    void startTimer();
     int  getElapsedTime();
     int  getUserTime() {return m_testParmList[m_index]->userTime;}
     void setRunning(bool state) {m_running = state;}
@@ -52,6 +54,7 @@ public:
     bool isEnabled() {return m_testParmList[m_index]->isEnabled;}
     bool isFirstRun() {return m_firstRun;}
     int  getIndex() {return m_index;}
+    void setIndex(int index) {m_index = index;}
     int  getTotalCount() {return m_totalCount;}
     void initTotalCount(int val=0) {m_totalCount = val;}
     void initTotalCorrect(int val=0) {m_totalCorrect = val;}
@@ -64,6 +67,25 @@ public:
     QList<TestParm*>& getTestParmList(){return m_testParmList;}
     TestParm* getTestParm(){return m_testParmList[m_index];}
     RandManager& getRandman();
+    RandManager& getRandman(int index);
+
+    // Copy the configuration of every TestParm into a flat, shareable
+    // table of test definitions, with matching indexes.
+    //
+    bool buildDefTable(TestDefTable& table)
+        {return table.build(m_testParmList);}
+    void loadDefTable(const TestDefTable& table);
+
+    // Save the configuration to a snapshot file, or start over from one.
+    //
+    bool saveSnapshot(const QString& fileName);
+    bool loadSnapshot(const QString& fileName);
+
+    // Lay out every problem of the enabled tests in a TestPlan and, if
+    // asked, draw all their terms up front.
+    //
+    void compilePlan(TestPlan& plan, bool generate = false)
+        {plan.compile(m_testParmList); if(generate) plan.generate(this);}
 
     // Access to the TestParm class
     //
@@ -107,6 +129,31 @@ public:
                         m_totalCorrect++;}
     int  getCurrentLevel() {return m_testParmList[m_index]->level;}
 
+    // Answer statistics. Every answer is counted in its own TestParm and
+    // in the overall stats as the pass is updated.
+    //
+    const TestStats& getStats() {return m_stats;}
+    const TestStats& getTestStats(int index)
+        {return m_testParmList[index]->stats;}
+    TestStats getTestTypeStats(const QString& testName);
+    TestStats getLevelStats(int level);
+    void mergeStats(TestParmManager& other);
+    void clearStats();
+
+    // Problem latency. Call beginProblem() before generating a problem
+    // and endGeneration() when it's ready. The time until startTimer()
+    // is then counted as display time. Either call can be left out, in
+    // which case that part isn't counted.
+    //
+    void beginProblem() {m_phaseTimer.start(); m_generatedAt = -1;}
+    void endGeneration();
+    LatencySnapshot getGenerationLatency()
+        {return m_stats.generateHist.snapshot();}
+    LatencySnapshot getDisplayLatency()
+        {return m_stats.displayHist.snapshot();}
+    LatencySnapshot getResponseLatency()
+        {return m_stats.responseHist.snapshot();}
+
 private:
 
     // A TestParm class is created for each level of each test type. If
@@ -126,8 +173,13 @@ private:
     int m_totalCorrect;         // Counts the correct answers
     int m_finalPercentScore;
     QElapsedTimer m_timer;        // an elapsed timer
+    QElapsedTimer m_phaseTimer;   // times generation and display
+    qint64 m_generatedAt;         // m_phaseTimer ns at endGeneration, or -1
     QString m_finalLetterScore;
+    QString m_testScore;          // text of the current test's score
+    QString m_finalScore;         // text of the final score
     QVector<int> m_operandLimits;
+    TestStats m_stats;            // stats for all tests and levels
 
     void writeEndOfTestCommon();
     void writeFinalsCommon();
@@ -0,0 +1,126 @@
+#include <QtCore>
+
+#include <testparm.h>
+#include <testparmmanager.h>
+#include <testdef.h>
+#include <testplan.h>
+
+/***********************
+** TestPlan Routines
+***********************/
+
+//*******************************************************************
+TestPlan::TestPlan()
+{
+    m_stride = 0;
+    m_pos = 0;
+    m_generated = false;
+}
+
+//*******************************************************************
+// compile
+//
+// Lay out a run of every enabled TestParm in a TestParmManager's list.
+//
+void TestPlan::compile(const QList<TestParm*>& list)
+{
+    m_steps.clear();
+    m_stride = 0;
+
+    for(int i = 0; i < list.size(); ++i) {
+        const TestParm* pt = list[i];
+        if(!pt->isEnabled)
+            continue;
+
+        int lvl = pt->level;
+        int terms = lvl < pt->maxterms.size() ? pt->maxterms[lvl] : 0;
+        addSteps(i, lvl, pt->count, terms);
+    }
+
+    m_terms.clear();
+    m_generated = false;
+    m_pos = 0;
+}
+
+//*******************************************************************
+// compile
+//
+// Lay out a run of every enabled test in a TestDefTable.
+//
+void TestPlan::compile(const TestDefTable& table)
+{
+    m_steps.clear();
+    m_stride = 0;
+
+    for(int i = 0; i < table.size(); ++i) {
+        const TestDef& def = table.def(i);
+        if(def.enabled)
+            addSteps(i, def.level, def.count, def.maxTerms);
+    }
+
+    m_terms.clear();
+    m_generated = false;
+    m_pos = 0;
+}
+
+//*******************************************************************
+// generate
+//
+// Draw the terms for every problem in the plan, using each test's own
+// RandManager so the usual checks for stale terms apply.
+//
+// ptm - the TestParmManager the plan was compiled from
+//
+// Returns the number of problems generated.
+//
+int TestPlan::generate(TestParmManager* ptm)
+{
+    QVector<int> vals;
+    RandManager* rm = 0;
+    int test = -1;
+
+    m_terms.resize(m_steps.size() * m_stride);
+    vals.reserve(m_stride);
+
+    for(int i = 0; i < m_steps.size(); ++i) {
+        PlanStep& st = m_steps[i];
+        int* out = m_terms.data() + i * m_stride;
+
+        if(st.test != test) {
+            test = st.test;
+            rm = &ptm->getRandman(test);
+        }
+        rm->getValues(vals);
+
+        int n = qMin(vals.size(), m_stride);
+        for(int j = 0; j < n; ++j)
+            out[j] = vals[j];
+        for(int j = n; j < m_stride; ++j)
+            out[j] = 0;
+        st.termCount = (quint8)n;
+    }
+
+    m_generated = true;
+    return m_steps.size();
+}
+
+//*******************************************************************
+// addSteps
+//
+// Append one step for each pass of a test.
+//
+void TestPlan::addSteps(int test, int level, int count, int terms)
+{
+    PlanStep st;
+    st.test = (qint16)test;
+    st.level = (quint8)level;
+    st.termCount = 0;
+
+    for(int pass = 0; pass < count; ++pass) {
+        st.pass = pass;
+        m_steps << st;
+    }
+
+    if(terms > m_stride)
+        m_stride = terms;
+}
@@ -0,0 +1,77 @@
+#ifndef TESTPLAN_H
+#define TESTPLAN_H
+
+#include <QList>
+#include <QVector>
+
+class TestParm;
+class TestParmManager;
+class TestDefTable;
+
+//********************************************************************
+//
+// struct PlanStep
+//
+// One problem in a test run.
+//
+// test      - index of the test in the TestParmManager or TestDefTable
+// level     - the level of difficulty
+// termCount - number of terms generated for the problem, 0 until
+//             TestPlan::generate() is called
+// pass      - which pass of the test this problem is
+//
+struct PlanStep
+{
+    qint16 test;
+    quint8 level;
+    quint8 termCount;
+    qint32 pass;
+};
+
+//********************************************************************
+//
+// class TestPlan
+//
+// The whole of a test run laid out in advance. compile() walks the
+// enabled tests once and lists every (test, level, pass) in the order
+// they will be presented, so finding the next problem is an array step
+// rather than a search for the next enabled test.
+//
+// generate() can then draw the terms of every problem before the run
+// starts, so none of that work is left for the time between answers.
+// The terms are kept in one flat array, maxTerms() ints per problem.
+//
+class TestPlan
+{
+public:
+    TestPlan();
+
+    void compile(const QList<TestParm*>& list);
+    void compile(const TestDefTable& table);
+    int  generate(TestParmManager* ptm);
+
+    int  size() const {return m_steps.size();}
+    int  maxTerms() const {return m_stride;}
+    bool isGenerated() const {return m_generated;}
+    const PlanStep& step(int index) const {return m_steps[index];}
+    const int* terms(int index) const
+        {return m_terms.constData() + index * m_stride;}
+
+    // Walking the plan
+    //
+    void rewind() {m_pos = 0;}
+    bool atEnd() const {return m_pos >= m_steps.size();}
+    int  position() const {return m_pos;}
+    const PlanStep& next() {return m_steps[m_pos++];}
+
+private:
+    QVector<PlanStep> m_steps;  // Every problem, in order
+    QVector<int> m_terms;       // m_stride terms for each step
+    int m_stride;               // Most terms any test can have
+    int m_pos;                  // Next step to present
+    bool m_generated;           // m_terms has been filled in
+
+    void addSteps(int test, int level, int count, int terms);
+};
+
+#endif // TESTPLAN_H
@@ -0,0 +1,266 @@
+#include <QtCore>
+#include <time.h>
+
+#include <mpscore.h>
+#include <numformat.h>
+#include <testsession.h>
+
+/**************************
+** TestSession Routines
+**************************/
+
+//*******************************************************************
+// TestSession constructor
+//
+// table - the test definitions this session runs. The session keeps a
+//         pointer to it and does not copy it.
+// seed  - seed for the session's random numbers, or 0 to make one
+//
+TestSession::TestSession(const TestDefTable* table, quint32 seed)
+{
+    static QAtomicInt sessions;
+
+    if(seed == 0) {
+        seed = (quint32)time(0)
+             ^ ((quint32)sessions.fetchAndAddRelaxed(1) * 0x9e3779b9u);
+        seed += (seed == 0);
+    }
+
+    m_table = table;
+    m_seed = seed;
+    m_randman.setSeed(seed);
+    m_deadline.data = this;
+    reset();
+}
+
+//*******************************************************************
+// reset
+//
+// Start the session over from the first test.
+//
+void TestSession::reset()
+{
+    m_state.resize(m_table->size());
+    for(int i = 0; i < m_state.size(); ++i)
+        m_state[i].clear();
+
+    m_index = 0;
+    m_totalCount = m_table->totalCount();
+    m_totalCorrect = 0;
+    m_randIndex = -1;
+    m_timeouts = 0;
+    m_deadline.unlink();
+    m_testScore[0] = '\0';
+    m_finalScore[0] = '\0';
+}
+
+//*******************************************************************
+// getNextTestIndex
+//
+// If the current test isn't enabled, or all its problems are done, move
+// on to the next enabled test and start it.
+//
+// Returns the index of the test to run, which is the size of the table
+// once there are no more.
+//
+int TestSession::getNextTestIndex()
+{
+    if(atSessionEnd())
+        return m_index;
+
+    const TestDef& def = m_table->def(m_index);
+    if(def.enabled && m_state[m_index].pass < def.count)
+        return m_index;
+
+    while(++m_index < m_table->size() && !m_table->def(m_index).enabled)
+        ;
+
+    if(m_index < m_table->size())
+        m_state[m_index].pass = 0;
+
+    return m_index;
+}
+
+//*******************************************************************
+// getElapsedTime
+//
+// Returns the time since startTimer() in msecs, and keeps it in the
+// current test's run state.
+//
+int TestSession::getElapsedTime()
+{
+    TestRunState& rs = m_state[m_index];
+    rs.userTime = (qint32)m_timer.elapsed();
+    return rs.userTime;
+}
+
+//*******************************************************************
+// updatePass
+//
+// Move on to the next pass. The problem is over, so its deadline is
+// cancelled.
+//
+void TestSession::updatePass()
+{
+    TestRunState& rs = m_state[m_index];
+
+    m_deadline.unlink();
+    rs.pass++;
+    rs.flags &= ~(TestRunState::Correct | TestRunState::OnTime);
+}
+
+//*******************************************************************
+void TestSession::bumpCorrect()
+{
+    TestRunState& rs = m_state[m_index];
+    rs.numberCorrect++;
+    rs.flags |= TestRunState::Correct;
+    m_totalCorrect++;
+}
+
+//*******************************************************************
+void TestSession::setOnTime(bool onTime)
+{
+    TestRunState& rs = m_state[m_index];
+
+    if(onTime)
+        rs.flags |= TestRunState::OnTime;
+    else
+        rs.flags &= ~TestRunState::OnTime;
+}
+
+//*******************************************************************
+// getRandman
+//
+// The session has a single RandManager. The first time it is asked for
+// after the test changes, it is given the new test's configuration. It
+// only starts over if that differs from the last test's.
+//
+RandManager& TestSession::getRandman()
+{
+    if(m_randIndex != m_index) {
+        const TestDef& def = m_table->def(m_index);
+        int bounds = def.boundsCount;
+
+        m_mins.resize(bounds);
+        m_maxs.resize(bounds);
+        for(int i = 0; i < bounds; ++i) {
+            m_mins[i] = m_table->minVals(m_index)[i];
+            m_maxs[i] = m_table->maxVals(m_index)[i];
+        }
+
+        m_randman.update(def.maxTerms, def.count, m_mins, m_maxs);
+        m_randIndex = m_index;
+    }
+    return m_randman;
+}
+
+//*******************************************************************
+// armDeadline
+//
+// Start the clock on the current problem, using the current test's
+// timeout in seconds.
+//
+// Returns false if the test has no timeout, in which case nothing is
+// armed.
+//
+bool TestSession::armDeadline(TimerWheel& wheel)
+{
+    int timeout = m_table->def(m_index).timeout;
+
+    if(timeout <= 0) {
+        m_deadline.unlink();
+        return false;
+    }
+
+    wheel.armMsecs(&m_deadline, (qint64)timeout * 1000);
+    return true;
+}
+
+//*******************************************************************
+// timeOut
+//
+// The user ran out of time on the current problem. Count it as a wrong,
+// late answer and move on to the next pass, which leaves the run state
+// neither correct nor on time. A deadline left over from a problem
+// already answered, e.g. the last one of the test, is ignored.
+//
+void TestSession::timeOut()
+{
+    m_deadline.unlink();
+    if(atSessionEnd() || atTestEnd())
+        return;
+
+    getElapsedTime();
+    m_timeouts++;
+    updatePass();
+}
+
+//*******************************************************************
+// expireDeadlines
+//
+// A TimerWheel::ExpireFn for session deadlines. Each node belongs to a
+// TestSession, which is timed out.
+//
+void TestSession::expireDeadlines(TimerNode** nodes, int count, void*)
+{
+    for(int i = 0; i < count; ++i)
+        ((TestSession*)nodes[i]->data)->timeOut();
+}
+
+//*******************************************************************
+// scoreTest
+//
+// Score the current test and build its score text.
+//
+// Returns the percent score.
+//
+int TestSession::scoreTest()
+{
+    TestRunState& rs = m_state[m_index];
+    MpScore score(m_table->def(m_index).count, rs.numberCorrect);
+    int percent = score.getPercentGrade();
+
+    rs.percentScore = (quint8)qBound(0, percent, 255);
+    formatScore(m_testScore, percent);
+    return percent;
+}
+
+//*******************************************************************
+// scoreFinals
+//
+// Score all the tests together and build the final score text.
+//
+// Returns the percent score.
+//
+int TestSession::scoreFinals()
+{
+    MpScore score(m_totalCount, m_totalCorrect);
+    int percent = score.getPercentGrade();
+
+    formatScore(m_finalScore, percent);
+    return percent;
+}
+
+//*******************************************************************
+// formatScore
+//
+// Writes "percent%  letter" into a ScoreSize buffer, e.g. "85%  B".
+// The longest possible is "-2147483648%  A+", which fits.
+//
+void TestSession::formatScore(char* buf, int percent)
+{
+    const GradeScale& scale = GradeScale::standard();
+    const char* letter = scale.gradeName(scale.gradeCode(percent));
+    char* end = buf + ScoreSize - 1;
+
+    char* p = nf::toChars(buf, end, percent);
+    if(p == 0)
+        p = buf;
+
+    for(const char* s = "%  "; *s && p < end; ++s)
+        *p++ = *s;
+    for(const char* s = letter; *s && p < end; ++s)
+        *p++ = *s;
+    *p = '\0';
+}
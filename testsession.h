@@ -0,0 +1,116 @@
+#ifndef TESTSESSION_H
+#define TESTSESSION_H
+
+#include <QVector>
+#include <QElapsedTimer>
+#include <randmanager.h>
+#include <testdef.h>
+#include <timerwheel.h>
+
+//********************************************************************
+//
+// class TestSession
+//
+// One user's run through the tests in a shared TestDefTable. It follows
+// the same state machine as TestParmManager, but all of its state is in
+// the object: the cursor, the timer, the totals, a TestRunState for each
+// test, the random number manager and the score text. There are no
+// statics and nothing is shared but the table, which is only read.
+//
+// A server can therefore keep thousands of sessions on one table and run
+// them from a thread pool. No locks are needed, as long as only one
+// thread at a time works on any one session.
+//
+// The table must outlive every session that uses it.
+//
+// Each session seeds its RandManager from its own seed. Pass one in to
+// repeat a session's problems. Otherwise the time is mixed with a count
+// of sessions made, so sessions started in the same second still get
+// different problems.
+//
+// Deadlines
+//
+// A server need not poll its sessions for problems left unanswered. Arm
+// the session's deadline on a TimerWheel when a problem is shown, and
+// cancel it when the answer comes. If the wheel reaches the deadline
+// first, pass expireDeadlines() to TimerWheel::advance() and each session
+// that ran out of time is marked late and moved on to its next pass.
+//
+class TestSession
+{
+public:
+    TestSession(const TestDefTable* table, quint32 seed = 0);
+    ~TestSession() {m_deadline.unlink();}
+
+    void reset();
+    const TestDefTable* getTable() {return m_table;}
+    quint32 getSeed() {return m_seed;}
+
+    // Test State Machine
+    //
+    void startTest() {m_state[m_index].pass = 0;}
+    int  getNextTestIndex();
+    int  getIndex() {return m_index;}
+    bool atTestEnd() {return m_state[m_index].pass >=
+                             m_table->def(m_index).count;}
+    bool atSessionEnd() {return m_index >= m_table->size();}
+    void startTimer() {m_timer.start();}
+    int  getElapsedTime();
+    void updatePass();
+    void bumpCorrect();
+    void setOnTime(bool onTime);
+
+    // The current test
+    //
+    const TestDef& getTestDef() {return m_table->def(m_index);}
+    TestRunState& getRunState() {return m_state[m_index];}
+    const TestRunState& getRunState(int index) {return m_state[index];}
+    RandManager& getRandman();
+
+    // Scoring. The score text is "percent%  letter", kept in buffers that
+    // belong to the session and good until the next call.
+    //
+    int scoreTest();
+    int scoreFinals();
+    const char* getTestScore() {return m_testScore;}
+    const char* getFinalScore() {return m_finalScore;}
+    int getTotalCount() {return m_totalCount;}
+    int getTotalCorrect() {return m_totalCorrect;}
+
+    // Deadlines
+    //
+    bool armDeadline(TimerWheel& wheel);
+    void cancelDeadline() {m_deadline.unlink();}
+    bool hasDeadline() const {return m_deadline.isArmed();}
+    void timeOut();
+    int  getTimeouts() {return m_timeouts;}
+    static void expireDeadlines(TimerNode** nodes, int count, void* context);
+
+private:
+    Q_DISABLE_COPY(TestSession)
+
+    enum { ScoreSize = 24 };
+
+    const TestDefTable* m_table;    // Shared, read-only test definitions
+    QVector<TestRunState> m_state;  // Run state for each test in the table
+    int m_index;                    // Current test
+    int m_totalCount;               // Problems in all enabled tests
+    int m_totalCorrect;             // Correct answers so far
+    QElapsedTimer m_timer;          // Times the user's answer
+
+    RandManager m_randman;          // Set up for one test at a time
+    quint32 m_seed;                 // Seed of m_randman
+    int m_randIndex;                // The test m_randman is set up for
+    QVector<int> m_mins;            // Operand limits for m_randman
+    QVector<int> m_maxs;
+
+    TimerNode m_deadline;           // The current problem's time limit
+    int m_timeouts;                 // Problems that ran out of time
+
+    char m_testScore[ScoreSize];
+    char m_finalScore[ScoreSize];
+
+    static void formatScore(char* buf, int percent);
+};
+
+#endif // TESTSESSION_H
@@ -0,0 +1,237 @@
+#include <QtCore/qmath.h>
+#include <QtAlgorithms>
+#include <teststats.h>
+
+/***********************
+** RunningStats Routines
+***********************/
+
+//*******************************************************************
+void RunningStats::add(double x)
+{
+    if(m_count == 0) {
+        m_min = x;
+        m_max = x;
+    } else {
+        m_min = qMin(m_min, x);
+        m_max = qMax(m_max, x);
+    }
+
+    ++m_count;
+    double delta = x - m_mean;
+    m_mean += delta / m_count;
+    m_m2 += delta * (x - m_mean);
+}
+
+//*******************************************************************
+void RunningStats::merge(const RunningStats& other)
+{
+    if(other.m_count == 0)
+        return;
+
+    if(m_count == 0) {
+        *this = other;
+        return;
+    }
+
+    double n = m_count + other.m_count;
+    double delta = other.m_mean - m_mean;
+
+    m_mean += delta * other.m_count / n;
+    m_m2 += other.m_m2 + delta * delta * m_count * other.m_count / n;
+    m_count += other.m_count;
+    m_min = qMin(m_min, other.m_min);
+    m_max = qMax(m_max, other.m_max);
+}
+
+//*******************************************************************
+double RunningStats::stddev() const
+{
+    return qSqrt(variance());
+}
+
+/***************************
+** LatencyHistogram Routines
+***************************/
+
+//*******************************************************************
+void LatencyHistogram::clear()
+{
+    for(int i = 0; i < BucketCount; ++i)
+        m_counts[i] = 0;
+
+    m_total = 0;
+    m_min = 0;
+    m_max = 0;
+}
+
+//*******************************************************************
+// bucketIndex
+//
+// Values below SubCount index themselves. Past that, a value whose top
+// bit is bit m is shifted right by g = m - SubBits + 1, which leaves it
+// between HalfCount and SubCount. That remainder picks one of the
+// HalfCount buckets for power of two g.
+//
+int LatencyHistogram::bucketIndex(quint64 value)
+{
+    if(value < SubCount)
+        return (int)value;
+
+    int msb = 63 - qCountLeadingZeroBits(value);
+    if(msb >= MaxBits)
+        return BucketCount - 1;
+
+    int g = msb - SubBits + 1;
+    return SubCount + (g - 1) * HalfCount + (int)(value >> g) - HalfCount;
+}
+
+//*******************************************************************
+quint64 LatencyHistogram::bucketLow(int index)
+{
+    if(index < SubCount)
+        return index;
+
+    int g = (index - SubCount) / HalfCount + 1;
+    quint64 sub = (index - SubCount) % HalfCount + HalfCount;
+    return sub << g;
+}
+
+//*******************************************************************
+quint64 LatencyHistogram::bucketHigh(int index)
+{
+    if(index < SubCount)
+        return index;
+
+    int g = (index - SubCount) / HalfCount + 1;
+    return bucketLow(index) + ((quint64)1 << g) - 1;
+}
+
+//*******************************************************************
+void LatencyHistogram::record(quint64 value)
+{
+    ++m_counts[bucketIndex(value)];
+
+    if(m_total == 0 || value < m_min)
+        m_min = value;
+    if(value > m_max)
+        m_max = value;
+    ++m_total;
+}
+
+//*******************************************************************
+void LatencyHistogram::merge(const LatencyHistogram& other)
+{
+    if(other.m_total == 0)
+        return;
+
+    for(int i = 0; i < BucketCount; ++i)
+        m_counts[i] += other.m_counts[i];
+
+    if(m_total == 0 || other.m_min < m_min)
+        m_min = other.m_min;
+    if(other.m_max > m_max)
+        m_max = other.m_max;
+    m_total += other.m_total;
+}
+
+//*******************************************************************
+// quantile
+//
+// q - 0.5 for the median, 0.99 for p99, and so on
+//
+// Returns the highest value that falls in the same bucket as the sample
+// at that rank, but never more than the largest value recorded.
+//
+quint64 LatencyHistogram::quantile(double q) const
+{
+    if(m_total == 0)
+        return 0;
+
+    q = q < 0.0 ? 0.0 : (q > 1.0 ? 1.0 : q);
+    quint64 rank = (quint64)qCeil(q * m_total);
+    if(rank == 0)
+        rank = 1;
+
+    quint64 seen = 0;
+    for(int i = 0; i < BucketCount; ++i) {
+        seen += m_counts[i];
+        if(seen >= rank)
+            return qMin(bucketHigh(i), m_max);
+    }
+    return m_max;
+}
+
+//*******************************************************************
+// snapshot
+//
+// The usual quantiles, found in one pass over the buckets rather than
+// one pass each.
+//
+LatencySnapshot LatencyHistogram::snapshot() const
+{
+    static const double qs[4] = {0.5, 0.9, 0.99, 0.999};
+    quint64 out[4] = {0, 0, 0, 0};
+    LatencySnapshot snap;
+
+    if(m_total > 0) {
+        quint64 ranks[4];
+        for(int k = 0; k < 4; ++k) {
+            ranks[k] = (quint64)qCeil(qs[k] * m_total);
+            if(ranks[k] == 0)
+                ranks[k] = 1;
+        }
+
+        quint64 seen = 0;
+        int k = 0;
+        for(int i = 0; i < BucketCount && k < 4; ++i) {
+            seen += m_counts[i];
+            while(k < 4 && seen >= ranks[k])
+                out[k++] = qMin(bucketHigh(i), m_max);
+        }
+    }
+
+    snap.count = m_total;
+    snap.min = min();
+    snap.max = m_max;
+    snap.p50 = out[0];
+    snap.p90 = out[1];
+    snap.p99 = out[2];
+    snap.p999 = out[3];
+    return snap;
+}
+
+/***********************
+** TestStats Routines
+***********************/
+
+//*******************************************************************
+void TestStats::clear()
+{
+    responseTime.clear();
+    responseHist.clear();
+    generateHist.clear();
+    displayHist.clear();
+    score.clear();
+}
+
+//*******************************************************************
+void TestStats::add(qint64 responseNsecs, bool correct)
+{
+    if(responseNsecs < 0)
+        responseNsecs = 0;
+
+    responseTime.add(responseNsecs);
+    responseHist.record(responseNsecs);
+    score.add(correct ? 1 : 0);
+}
+
+//*******************************************************************
+void TestStats::merge(const TestStats& other)
+{
+    responseTime.merge(other.responseTime);
+    responseHist.merge(other.responseHist);
+    generateHist.merge(other.generateHist);
+    displayHist.merge(other.displayHist);
+    score.merge(other.score);
+}
@@ -0,0 +1,137 @@
+#ifndef TESTSTATS_H
+#define TESTSTATS_H
+
+#include <QtGlobal>
+
+//********************************************************************
+//
+// class RunningStats
+//
+// Streaming count, mean, variance, min and max of a series of samples,
+// using Welford's update. Nothing is kept per sample. Two of these can be
+// merged, e.g. from different sessions or threads, as if every sample
+// had gone into one (Chan et al., 1979).
+//
+class RunningStats
+{
+public:
+    RunningStats() {clear();}
+
+    void clear() {m_count = 0; m_mean = 0; m_m2 = 0; m_min = 0; m_max = 0;}
+    void add(double x);
+    void merge(const RunningStats& other);
+
+    qint64 count() const {return m_count;}
+    double mean() const {return m_mean;}
+    double variance() const {return m_count > 1 ? m_m2 / (m_count - 1) : 0;}
+    double stddev() const;
+    double min() const {return m_min;}
+    double max() const {return m_max;}
+
+private:
+    qint64 m_count;     // Number of samples
+    double m_mean;      // Running mean
+    double m_m2;        // Sum of squared differences from the mean
+    double m_min;       // Smallest sample
+    double m_max;       // Largest sample
+};
+
+//********************************************************************
+//
+// struct LatencySnapshot
+//
+// The summary of a LatencyHistogram at one moment, in nanoseconds. Being
+// plain values, it can be handed to another thread or logged as is.
+//
+struct LatencySnapshot
+{
+    quint64 count;
+    quint64 min;
+    quint64 max;
+    quint64 p50;
+    quint64 p90;
+    quint64 p99;
+    quint64 p999;
+};
+
+//********************************************************************
+//
+// class LatencyHistogram
+//
+// Fixed-size log-linear histogram in the style of HdrHistogram, for
+// latencies in nanoseconds. Values below 64 get a bucket each. Above
+// that, each power of two is split into 32 buckets, so any value is
+// known to within 1/32 (about 3%). Values from 2^44 ns, nearly five
+// hours, up are counted in the top bucket.
+//
+// Recording is a shift, a count-leading-zeros and an increment. Merging
+// two histograms adds their buckets.
+//
+class LatencyHistogram
+{
+public:
+    enum {
+        SubBits = 6,                        // log2 of linear range
+        SubCount = 1 << SubBits,            // 64 single-value buckets
+        HalfCount = SubCount / 2,           // 32 buckets per power of 2
+        MaxBits = 44,                       // Values >= 2^44 saturate
+        BucketCount = SubCount + (MaxBits - SubBits) * HalfCount
+    };
+
+    LatencyHistogram() {clear();}
+
+    void clear();
+    void record(quint64 value);
+    void merge(const LatencyHistogram& other);
+
+    quint64 count() const {return m_total;}
+    quint64 min() const {return m_total ? m_min : 0;}
+    quint64 max() const {return m_max;}
+    quint64 quantile(double q) const;
+    quint64 bucketCount(int index) const {return m_counts[index];}
+    LatencySnapshot snapshot() const;
+
+    static int bucketIndex(quint64 value);
+    static quint64 bucketLow(int index);
+    static quint64 bucketHigh(int index);
+
+private:
+    quint32 m_counts[BucketCount];
+    quint64 m_total;
+    quint64 m_min;
+    quint64 m_max;
+};
+
+//********************************************************************
+//
+// class TestStats
+//
+// What's known about the answers to one set of problems.
+//
+// responseTime - mean and spread of the user's response time, in ns
+// responseHist - distribution of the same, for quantiles
+// generateHist - time taken to generate each problem, in ns
+// displayHist  - time from the problem being generated to its being shown
+//                and the response timer started, in ns
+// score        - 1 for each correct answer, 0 for each wrong one, so the
+//                mean is the fraction answered correctly
+//
+class TestStats
+{
+public:
+    void clear();
+    void add(qint64 responseNsecs, bool correct);
+    void addGeneration(qint64 nsecs)
+        {generateHist.record(nsecs > 0 ? nsecs : 0);}
+    void addDisplay(qint64 nsecs)
+        {displayHist.record(nsecs > 0 ? nsecs : 0);}
+    void merge(const TestStats& other);
+
+    RunningStats responseTime;
+    LatencyHistogram responseHist;
+    LatencyHistogram generateHist;
+    LatencyHistogram displayHist;
+    RunningStats score;
+};
+
+#endif // TESTSTATS_H
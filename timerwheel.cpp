@@ -0,0 +1,159 @@
+#include <timerwheel.h>
+
+/************************
+** TimerWheel Routines
+************************/
+
+//*******************************************************************
+// TimerWheel constructor
+//
+// tickMsecs - length of a tick, for armMsecs() and advanceMsecs(). The
+//             wheel starts at tick 0, so the clock the owner advances it
+//             by should start along with it.
+//
+TimerWheel::TimerWheel(int tickMsecs)
+{
+    for(int level = 0; level < LevelCount; ++level) {
+        for(int i = 0; i < SlotCount; ++i) {
+            TimerNode* head = &m_slots[level][i];
+            head->next = head;
+            head->prev = head;
+        }
+    }
+
+    m_base = 0;
+    m_tickMsecs = tickMsecs > 0 ? tickMsecs : 1;
+}
+
+//*******************************************************************
+// arm
+//
+// Set a timer to fire a number of ticks after the next tick to be
+// processed, so at least that many whole ticks go by before it fires,
+// however far into the current tick it is armed. A timer that is
+// already armed is moved.
+//
+// node  - the timer
+// ticks - delay, 1 or more
+//
+void TimerWheel::arm(TimerNode* node, quint64 ticks)
+{
+    if(ticks < 1)
+        ticks = 1;
+    if(ticks > MaxDelay)
+        ticks = MaxDelay;
+
+    node->unlink();
+    node->expires = m_base + ticks;
+    insert(node);
+}
+
+//*******************************************************************
+// armMsecs
+//
+// Same as arm(), with the delay given in msecs and rounded up to whole
+// ticks.
+//
+void TimerWheel::armMsecs(TimerNode* node, qint64 msecs)
+{
+    if(msecs < 0)
+        msecs = 0;
+    arm(node, (quint64)((msecs + m_tickMsecs - 1) / m_tickMsecs));
+}
+
+//*******************************************************************
+// advance
+//
+// Process every tick up to and including now, firing the timers that
+// fall due. The timers of each tick are taken off the wheel and passed to
+// fn in one call. The callback may arm or cancel any timer, including
+// the ones it was passed.
+//
+// Returns the number of timers fired.
+//
+int TimerWheel::advance(quint64 now, ExpireFn fn, void* context)
+{
+    int fired = 0;
+
+    while(m_base <= now) {
+        int index = (int)(m_base & SlotMask);
+
+        // At the start of each turn of a wheel, move the timers in the
+        // next slot of the wheel above down into it.
+        //
+        for(int level = 1; level < LevelCount && index == 0; ++level) {
+            index = (int)((m_base >> (SlotBits * level)) & SlotMask);
+            cascade(level, index);
+        }
+
+        TimerNode* head = &m_slots[0][m_base & SlotMask];
+        m_batch.clear();
+        while(head->next != head) {
+            TimerNode* node = head->next;
+            node->unlink();
+            m_batch << node;
+        }
+
+        ++m_base;
+
+        if(!m_batch.isEmpty()) {
+            fired += m_batch.size();
+            fn(m_batch.data(), m_batch.size(), context);
+        }
+    }
+    return fired;
+}
+
+//*******************************************************************
+// insert
+//
+// Put a timer in the slot for its expiry tick, on the lowest wheel that
+// reaches that far.
+//
+void TimerWheel::insert(TimerNode* node)
+{
+    quint64 delta = node->expires - m_base;
+    int level = 0;
+
+    while(level < LevelCount - 1
+       && delta >= ((quint64)1 << (SlotBits * (level + 1))))
+        ++level;
+
+    int index = (int)((node->expires >> (SlotBits * level)) & SlotMask);
+    TimerNode* head = &m_slots[level][index];
+
+    node->prev = head->prev;
+    node->next = head;
+    head->prev->next = node;
+    head->prev = node;
+}
+
+//*******************************************************************
+// cascade
+//
+// Move every timer out of a slot and back in, which puts each one a
+// wheel lower now that it is nearer its time.
+//
+void TimerWheel::cascade(int level, int index)
+{
+    TimerNode* head = &m_slots[level][index];
+    TimerNode list;
+
+    if(head->next == head)
+        return;
+
+    // Take the whole slot at once, then reinsert from the detached list.
+    //
+    list.next = head->next;
+    list.prev = head->prev;
+    list.next->prev = &list;
+    list.prev->next = &list;
+    head->next = head;
+    head->prev = head;
+
+    while(list.next != &list) {
+        TimerNode* node = list.next;
+        node->unlink();
+        insert(node);
+    }
+}
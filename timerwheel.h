@@ -0,0 +1,88 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <QtGlobal>
+#include <QVector>
+
+//********************************************************************
+//
+// struct TimerNode
+//
+// A timer, kept inside the object it times, so arming it never
+// allocates. The wheel strings the nodes of each slot into a circular
+// list, so a node can take itself out in constant time.
+//
+// next, prev - links in the wheel's slot list, 0 when not armed
+// expires    - the tick at which the timer fires
+// data       - whatever the owner needs to find itself in the callback
+//
+struct TimerNode
+{
+    TimerNode* next;
+    TimerNode* prev;
+    quint64 expires;
+    void* data;
+
+    TimerNode() {next = 0; prev = 0; expires = 0; data = 0;}
+    bool isArmed() const {return next != 0;}
+    void unlink() {if(next) {prev->next = next; next->prev = prev;
+                             next = 0; prev = 0;}}
+};
+
+//********************************************************************
+//
+// class TimerWheel
+//
+// Hierarchical timing wheel for deadlines on many sessions at once.
+// There are four wheels of 64 slots. The first holds timers due within
+// 64 ticks, one slot per tick. Each wheel after that covers 64 times as
+// much time, and its timers are moved down a wheel as their time comes
+// closer. So arming, cancelling and firing a timer all cost the same
+// however many timers there are, and 2^24 ticks (at 100 msecs a tick,
+// about 19 days) can be reached. Longer delays are cut to that.
+//
+// The wheel knows nothing of clocks. The owner calls advance() with the
+// current tick, e.g. from a QTimer. All the timers due at a tick are
+// passed to the callback together, once for each tick.
+//
+// A TimerWheel is not thread safe. Give each thread its own, or lock
+// around it.
+//
+class TimerWheel
+{
+public:
+    typedef void (*ExpireFn)(TimerNode** nodes, int count, void* context);
+
+    enum {
+        SlotBits = 6,
+        SlotCount = 1 << SlotBits,
+        SlotMask = SlotCount - 1,
+        LevelCount = 4,
+        MaxDelay = (1 << (SlotBits * LevelCount)) - 1
+    };
+
+    TimerWheel(int tickMsecs = 100);
+
+    void arm(TimerNode* node, quint64 ticks);
+    void armMsecs(TimerNode* node, qint64 msecs);
+    void cancel(TimerNode* node) {node->unlink();}
+    int  advance(quint64 now, ExpireFn fn, void* context = 0);
+    int  advanceMsecs(qint64 msecs, ExpireFn fn, void* context = 0)
+        {return advance(msecs / m_tickMsecs, fn, context);}
+
+    quint64 currentTick() const {return m_base;}
+    int tickMsecs() const {return m_tickMsecs;}
+
+private:
+    Q_DISABLE_COPY(TimerWheel)
+
+    TimerNode m_slots[LevelCount][SlotCount];   // List heads, one per slot
+    QVector<TimerNode*> m_batch;                // Timers firing this tick
+    quint64 m_base;                             // Next tick to process
+    int m_tickMsecs;
+
+    void insert(TimerNode* node);
+    void cascade(int level, int index);
+};
+
+#endif // TIMERWHEEL_H